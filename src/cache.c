@@ -0,0 +1,431 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "cache.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#include <utime.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* "ZPCACHE1" */
+static uint64_t const CACHE_MAGIC = 0x5a50434143484531ULL;
+
+/* bump whenever the key or file layout changes */
+static uint64_t const CACHE_VERSION = 1;
+
+static char const * const CACHE_EXT = ".zpc";
+
+/* magic, nglobal_v, nparts */
+#define CACHE_HEADER_LEN 3
+
+/**
+* @brief A cache file found while evicting.
+*/
+typedef struct
+{
+  char * path;
+  long long size;
+  time_t mtime;
+} cache_entry;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief The splitmix64 finalizer.
+*/
+static inline uint64_t __mix(
+    uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+
+/**
+* @brief Hash a "KEY=VAL" pair, ignoring the case of KEY.
+*/
+static uint64_t __hash_param(
+    char const * key,
+    char const * val)
+{
+  /* FNV-1a */
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for(; *key != '\0'; ++key) {
+    h = (h ^ (uint64_t) toupper((unsigned char) *key)) * 0x100000001b3ULL;
+  }
+  h = (h ^ (uint64_t) '=') * 0x100000001b3ULL;
+  for(; *val != '\0'; ++val) {
+    h = (h ^ (uint64_t) (unsigned char) *val) * 0x100000001b3ULL;
+  }
+  return __mix(h);
+}
+
+
+static char * __cache_path(
+    char const * const dir,
+    char const * const key,
+    char const * const suffix)
+{
+  char * path = NULL;
+  asprintf(&path, "%s/%s%s%s", dir, key, CACHE_EXT, suffix);
+  return path;
+}
+
+
+static idx_t const * __sort_gids;
+
+static int __cmp_by_gid(
+    void const * a,
+    void const * b)
+{
+  idx_t const x = __sort_gids[*(int const *) a];
+  idx_t const y = __sort_gids[*(int const *) b];
+  return (x < y) ? -1 : (x > y);
+}
+
+
+/**
+* @brief Read or write the parts of my vertices, one contiguous run of global
+*        IDs at a time.
+*
+* @param fp The open cache file.
+* @param hg The distributed hypergraph.
+* @param parts The parts of my vertices.
+* @param writing Write 'parts' if 1, otherwise read into 'parts'.
+*
+* @return 1 on success, 0 on a short read or write.
+*/
+static int __io_runs(
+    FILE * fp,
+    hgraph const * const hg,
+    int * const parts,
+    int writing)
+{
+  int const nv = hg->nlocal_v;
+  int * order = (int *) malloc((nv+1) * sizeof(int));
+  for(int v=0; v < nv; ++v) {
+    order[v] = v;
+  }
+  __sort_gids = hg->v_gids;
+  qsort(order, nv, sizeof(int), __cmp_by_gid);
+
+  int32_t * buf = (int32_t *) malloc((nv+1) * sizeof(int32_t));
+  int ok = 1;
+
+  int start = 0;
+  while(ok && start < nv) {
+    int end = start + 1;
+    while(end < nv &&
+        hg->v_gids[order[end]] == hg->v_gids[order[end-1]] + 1) {
+      ++end;
+    }
+    int const len = end - start;
+    off_t const offset = (off_t) ((CACHE_HEADER_LEN * sizeof(uint64_t)) +
+        ((size_t) hg->v_gids[order[start]] * sizeof(int32_t)));
+
+    fseeko(fp, offset, SEEK_SET);
+    if(writing) {
+      for(int i=0; i < len; ++i) {
+        buf[i] = (int32_t) parts[order[start + i]];
+      }
+      ok = (fwrite(buf, sizeof(int32_t), len, fp) == (size_t) len);
+    } else {
+      ok = (fread(buf, sizeof(int32_t), len, fp) == (size_t) len);
+      for(int i=0; ok && i < len; ++i) {
+        parts[order[start + i]] = (int) buf[i];
+      }
+    }
+    start = end;
+  }
+
+  free(buf);
+  free(order);
+  return ok;
+}
+
+
+static int __cmp_entry(
+    void const * a,
+    void const * b)
+{
+  cache_entry const * const x = (cache_entry const *) a;
+  cache_entry const * const y = (cache_entry const *) b;
+  return (x->mtime < y->mtime) ? -1 : (x->mtime > y->mtime);
+}
+
+
+/**
+* @brief Delete the least recently used cache files until the directory holds
+*        at most 'max_bytes'. The entry 'keep' is never deleted.
+*/
+static void __evict(
+    char const * const dir,
+    char const * const keep,
+    long long max_bytes)
+{
+  DIR * d = opendir(dir);
+  if(d == NULL) {
+    return;
+  }
+
+  cache_entry * entries = NULL;
+  int nentries = 0;
+  long long total = 0;
+  size_t const extlen = strlen(CACHE_EXT);
+
+  struct dirent * ent;
+  while((ent = readdir(d)) != NULL) {
+    size_t const len = strlen(ent->d_name);
+    if(len <= extlen || strcmp(ent->d_name + len - extlen, CACHE_EXT) != 0) {
+      continue;
+    }
+    char * path = NULL;
+    asprintf(&path, "%s/%s", dir, ent->d_name);
+    struct stat st;
+    if(stat(path, &st) != 0) {
+      free(path);
+      continue;
+    }
+    entries = (cache_entry *) realloc(entries,
+        (nentries+1) * sizeof(*entries));
+    entries[nentries].path = path;
+    entries[nentries].size = (long long) st.st_size;
+    entries[nentries].mtime = st.st_mtime;
+    total += entries[nentries].size;
+    ++nentries;
+  }
+  closedir(d);
+
+  qsort(entries, nentries, sizeof(*entries), __cmp_entry);
+  for(int i=0; i < nentries && total > max_bytes; ++i) {
+    if(strcmp(entries[i].path, keep) == 0) {
+      continue;
+    }
+    if(unlink(entries[i].path) == 0) {
+      total -= entries[i].size;
+    }
+  }
+
+  for(int i=0; i < nentries; ++i) {
+    free(entries[i].path);
+  }
+  free(entries);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+void cache_key(
+    hgraph const * const hg,
+    int nparts,
+    zparams const * const params,
+    MPI_Comm comm,
+    char * const key)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  /* hash each hyperedge in order, then combine commutatively */
+  uint64_t local[2] = {0, 0};
+  idx_t * scratch = hgraph_scratch(hg);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    int const npins = hg->eptr[h+1] - hg->eptr[h];
+    uint64_t hh = __mix((uint64_t) hg->h_gids[h]);
+    for(int n=0; n < npins; ++n) {
+      hh = __mix(hh ^ (uint64_t) pins[n]);
+    }
+    local[0] += __mix(hh);
+    local[1] ^= __mix(hh ^ 0x5bd1e995ULL);
+  }
+  free(scratch);
+  uint64_t global[2];
+  MPI_Allreduce(&local[0], &global[0], 1, MPI_UINT64_T, MPI_SUM, comm);
+  MPI_Allreduce(&local[1], &global[1], 1, MPI_UINT64_T, MPI_BXOR, comm);
+
+  /* everything else which affects the result */
+  zparams eff = {0, NULL, NULL};
+  zparams_effective(&eff, nparts, params);
+  uint64_t phash = 0;
+  for(int i=0; i < eff.nparams; ++i) {
+    phash += __hash_param(eff.keys[i], eff.vals[i]);
+  }
+  zparams_free(&eff);
+
+  uint64_t meta = __mix(CACHE_VERSION);
+  meta = __mix(meta ^ (uint64_t) hg->nglobal_v);
+  meta = __mix(meta ^ (uint64_t) hg->nglobal_h);
+  meta = __mix(meta ^ (uint64_t) nparts);
+  meta = __mix(meta ^ (uint64_t) npes);
+  meta = __mix(meta ^ (uint64_t) hg->layout);
+  meta = __mix(meta ^ phash);
+
+  uint64_t const a = __mix(global[0] ^ meta);
+  uint64_t const b = __mix(global[1] + __mix(meta));
+  snprintf(key, CACHE_KEY_LEN, "%016llx%016llx", (unsigned long long) a,
+      (unsigned long long) b);
+}
+
+
+int * cache_load(
+    char const * const dir,
+    char const * const key,
+    hgraph const * const hg,
+    int nparts,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  char * path = __cache_path(dir, key, "");
+
+  /* rank 0 checks the header */
+  int hit = 0;
+  if(rank == 0) {
+    FILE * fp = fopen(path, "rb");
+    if(fp != NULL) {
+      uint64_t header[CACHE_HEADER_LEN];
+      if(fread(header, sizeof(uint64_t), CACHE_HEADER_LEN, fp) ==
+            CACHE_HEADER_LEN &&
+          header[0] == CACHE_MAGIC &&
+          header[1] == (uint64_t) hg->nglobal_v &&
+          header[2] == (uint64_t) nparts) {
+        hit = 1;
+      }
+      fclose(fp);
+    }
+  }
+  MPI_Bcast(&hit, 1, MPI_INT, 0, comm);
+  if(!hit) {
+    free(path);
+    return NULL;
+  }
+
+  /* everyone reads their own vertices */
+  int * parts = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  FILE * fp = fopen(path, "rb");
+  int ok = (fp != NULL) && __io_runs(fp, hg, parts, 0);
+  if(fp != NULL) {
+    fclose(fp);
+  }
+  for(int v=0; ok && v < hg->nlocal_v; ++v) {
+    if(parts[v] < 0 || parts[v] >= nparts) {
+      ok = 0;
+    }
+  }
+  int allok;
+  MPI_Allreduce(&ok, &allok, 1, MPI_INT, MPI_MIN, comm);
+  if(!allok) {
+    free(parts);
+    free(path);
+    return NULL;
+  }
+
+  /* mark as recently used */
+  if(rank == 0) {
+    utime(path, NULL);
+  }
+  free(path);
+  return parts;
+}
+
+
+void cache_store(
+    char const * const dir,
+    char const * const key,
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    long long max_bytes,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  char * path = __cache_path(dir, key, "");
+  /* unique per job, so concurrent stores of one key never share a file */
+  char * tmp = __cache_path(dir, key, ".XXXXXX");
+
+  /* rank 0 creates the file at full size */
+  int ok = 0;
+  if(rank == 0) {
+    if(mkdir(dir, 0755) != 0 && errno != EEXIST) {
+      fprintf(stderr, "ZPART: failed to create cache directory '%s'\n", dir);
+    } else {
+      int const fd = mkstemp(tmp);
+      FILE * fp = NULL;
+      if(fd >= 0) {
+        fchmod(fd, 0644);
+        fp = fdopen(fd, "wb");
+        if(fp == NULL) {
+          close(fd);
+        }
+      }
+      if(fp != NULL) {
+        uint64_t header[CACHE_HEADER_LEN];
+        header[0] = CACHE_MAGIC;
+        header[1] = (uint64_t) hg->nglobal_v;
+        header[2] = (uint64_t) nparts;
+        ok = (fwrite(header, sizeof(uint64_t), CACHE_HEADER_LEN, fp) ==
+            CACHE_HEADER_LEN);
+        off_t const size = (off_t) ((CACHE_HEADER_LEN * sizeof(uint64_t)) +
+            ((size_t) hg->nglobal_v * sizeof(int32_t)));
+        ok = ok && (ftruncate(fileno(fp), size) == 0);
+        fclose(fp);
+      } else {
+        fprintf(stderr, "ZPART: failed to open '%s'\n", tmp);
+      }
+    }
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  /* the name mkstemp() chose has the same length as the template */
+  MPI_Bcast(tmp, (int) strlen(tmp) + 1, MPI_CHAR, 0, comm);
+
+  /* everyone writes their own vertices */
+  if(ok) {
+    FILE * fp = fopen(tmp, "r+b");
+    ok = (fp != NULL) && __io_runs(fp, hg, (int *) parts, 1);
+    if(fp != NULL) {
+      fclose(fp);
+    }
+  }
+  int allok;
+  MPI_Allreduce(&ok, &allok, 1, MPI_INT, MPI_MIN, comm);
+
+  if(rank == 0) {
+    if(allok && rename(tmp, path) == 0) {
+      __evict(dir, path, max_bytes);
+    } else {
+      unlink(tmp);
+    }
+  }
+
+  free(path);
+  free(tmp);
+}
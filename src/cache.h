@@ -0,0 +1,93 @@
+#ifndef ZPART_CACHE_H
+#define ZPART_CACHE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+#include "part.h"
+
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+/* 128-bit keys as hex, plus a terminator */
+#define CACHE_KEY_LEN 33
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define cache_key zpart_cache_key
+/**
+* @brief Compute the cache key of a partitioning run. The key covers the
+*        hypergraph content, the layout served to Zoltan, the number of parts
+*        and ranks, and all effective Zoltan parameters (including SEED). Each
+*        rank hashes its own hyperedges and the hashes are combined with an
+*        order-independent reduction, so the key does not depend on which rank
+*        holds which hyperedge.
+*
+* @param hg The distributed hypergraph.
+* @param nparts The number of parts.
+* @param params Zoltan parameter overrides. May be NULL.
+* @param comm The communicator the hypergraph is distributed among.
+* @param key [OUT] The key as a hex string of CACHE_KEY_LEN bytes.
+*/
+void cache_key(
+    hgraph const * const hg,
+    int nparts,
+    zparams const * const params,
+    MPI_Comm comm,
+    char * const key);
+
+
+#define cache_load zpart_cache_load
+/**
+* @brief Look up a partition in the cache. On a hit, each rank reads the parts
+*        of its own vertices directly from the cache file.
+*
+* @param dir The cache directory.
+* @param key The cache key from cache_key().
+* @param hg The distributed hypergraph.
+* @param nparts The number of parts.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return parts[v] is the part of local vertex 'v', or NULL on a miss. Must be
+*         freed!
+*/
+int * cache_load(
+    char const * const dir,
+    char const * const key,
+    hgraph const * const hg,
+    int nparts,
+    MPI_Comm comm);
+
+
+#define cache_store zpart_cache_store
+/**
+* @brief Store a partition in the cache. Each rank writes the parts of its own
+*        vertices, and then the least recently used entries are evicted until
+*        the cache fits in 'max_bytes'.
+*
+* @param dir The cache directory. Created if it does not exist.
+* @param key The cache key from cache_key().
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'.
+* @param nparts The number of parts.
+* @param max_bytes The maximum size of the cache directory.
+* @param comm The communicator the hypergraph is distributed among.
+*/
+void cache_store(
+    char const * const dir,
+    char const * const key,
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    long long max_bytes,
+    MPI_Comm comm);
+
+#endif
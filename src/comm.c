@@ -0,0 +1,222 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "comm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Return the directory rank which stores the value of vertex 'v'.
+*
+* @param v The global vertex ID.
+* @param chunk The number of vertices per directory rank.
+*
+* @return The owning rank.
+*/
+static inline int __dir_rank(
+    idx_t const v,
+    idx_t const chunk)
+{
+  return (int) (v / chunk);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+int * comm_bucket(
+    int const * const dest,
+    int nitems,
+    int * const sendcounts,
+    MPI_Comm comm)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  int * perm = (int *) malloc((nitems+1) * sizeof(int));
+  int * offsets = (int *) malloc((npes+1) * sizeof(int));
+
+  memset(sendcounts, 0, npes * sizeof(int));
+  for(int i=0; i < nitems; ++i) {
+    ++sendcounts[dest[i]];
+  }
+
+  offsets[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    offsets[p+1] = offsets[p] + sendcounts[p];
+  }
+  for(int i=0; i < nitems; ++i) {
+    perm[i] = offsets[dest[i]]++;
+  }
+
+  free(offsets);
+  return perm;
+}
+
+
+void * comm_exchange(
+    void const * const sendbuf,
+    int const * const sendcounts,
+    MPI_Datatype type,
+    int * nrecv,
+    int * recvcounts,
+    MPI_Comm comm)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  int tsize;
+  MPI_Type_size(type, &tsize);
+
+  int * rcounts = recvcounts;
+  if(rcounts == NULL) {
+    rcounts = (int *) malloc(npes * sizeof(int));
+  }
+  int * sdispls = (int *) malloc(npes * sizeof(int));
+  int * rdispls = (int *) malloc(npes * sizeof(int));
+
+  MPI_Alltoall(sendcounts, 1, MPI_INT, rcounts, 1, MPI_INT, comm);
+
+  sdispls[0] = 0;
+  rdispls[0] = 0;
+  for(int p=1; p < npes; ++p) {
+    sdispls[p] = sdispls[p-1] + sendcounts[p-1];
+    rdispls[p] = rdispls[p-1] + rcounts[p-1];
+  }
+  int const total = rdispls[npes-1] + rcounts[npes-1];
+
+  /* +1 so we never malloc(0) */
+  void * recvbuf = malloc((total+1) * tsize);
+  MPI_Alltoallv(sendbuf, sendcounts, sdispls, type,
+      recvbuf, rcounts, rdispls, type, comm);
+
+  free(sdispls);
+  free(rdispls);
+  if(recvcounts == NULL) {
+    free(rcounts);
+  }
+
+  *nrecv = total;
+  return recvbuf;
+}
+
+
+int * comm_pin_lookup(
+    hgraph const * const hg,
+    int const * const vals,
+    MPI_Comm comm)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  idx_t chunk = (hg->nglobal_v + npes - 1) / npes;
+  if(chunk == 0) {
+    chunk = 1;
+  }
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * recvcounts = (int *) malloc(npes * sizeof(int));
+
+  /* register the values of my vertices with the directory */
+  int * dest = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    dest[v] = __dir_rank(hg->v_gids[v], chunk);
+  }
+  int * perm = comm_bucket(dest, hg->nlocal_v, sendcounts, comm);
+  idx_t * sgids = (idx_t *) malloc((hg->nlocal_v+1) * sizeof(idx_t));
+  int * svals = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    sgids[perm[v]] = hg->v_gids[v];
+    svals[perm[v]] = vals[v];
+  }
+  free(perm);
+  free(dest);
+
+  int nrecv;
+  idx_t * rgids = comm_exchange(sgids, sendcounts, ZOLTAN_ID_MPI_TYPE, &nrecv,
+      NULL, comm);
+  int * rvals = comm_exchange(svals, sendcounts, MPI_INT, &nrecv, NULL, comm);
+  free(sgids);
+  free(svals);
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  idx_t const dstart = rank * chunk;
+  int * dir = (int *) malloc((chunk+1) * sizeof(int));
+  for(int i=0; i < nrecv; ++i) {
+    assert(__dir_rank(rgids[i], chunk) == rank);
+    dir[rgids[i] - dstart] = rvals[i];
+  }
+  free(rgids);
+  free(rvals);
+
+  /* now query the directory for each pin, walking the pins twice instead of
+   * keeping a decoded copy of a compressed hypergraph */
+  int const ncon = hg->nlocal_con;
+  idx_t * scratch = hgraph_scratch(hg);
+  dest = (int *) malloc((ncon+1) * sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      dest[n] = __dir_rank(pins[n - hg->eptr[h]], chunk);
+    }
+  }
+  perm = comm_bucket(dest, ncon, sendcounts, comm);
+  free(dest);
+  /* put the pins in send order */
+  idx_t * query = (idx_t *) malloc((ncon+1) * sizeof(idx_t));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      query[perm[n]] = pins[n - hg->eptr[h]];
+    }
+  }
+  free(scratch);
+
+  int nquery;
+  idx_t * rquery = comm_exchange(query, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nquery, recvcounts, comm);
+  free(query);
+
+  /* answer queries in place and send them back */
+  int * answers = (int *) malloc((nquery+1) * sizeof(int));
+  for(int q=0; q < nquery; ++q) {
+    answers[q] = dir[rquery[q] - dstart];
+  }
+  free(rquery);
+  free(dir);
+
+  int nans;
+  int * ranswers = comm_exchange(answers, recvcounts, MPI_INT, &nans, NULL,
+      comm);
+  assert(nans == ncon);
+  free(answers);
+
+  int * pinvals = (int *) malloc((ncon+1) * sizeof(int));
+  for(int n=0; n < ncon; ++n) {
+    pinvals[n] = ranswers[perm[n]];
+  }
+
+  free(ranswers);
+  free(perm);
+  free(sendcounts);
+  free(recvcounts);
+  return pinvals;
+}
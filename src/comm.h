@@ -0,0 +1,76 @@
+#ifndef ZPART_COMM_H
+#define ZPART_COMM_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define comm_bucket zpart_comm_bucket
+/**
+* @brief Bucket items by destination rank, as needed for comm_exchange().
+*
+* @param dest dest[i] is the rank that item 'i' is sent to.
+* @param nitems The number of items.
+* @param sendcounts [OUT] The number of items sent to each rank (length npes).
+* @param comm The communicator to exchange among.
+*
+* @return perm[i] is the position of item 'i' in the send buffer. Must be
+*         freed!
+*/
+int * comm_bucket(
+    int const * const dest,
+    int nitems,
+    int * const sendcounts,
+    MPI_Comm comm);
+
+
+#define comm_exchange zpart_comm_exchange
+/**
+* @brief Personalized all-to-all exchange of a bucketed buffer.
+*
+* @param sendbuf The buffer to send, ordered by destination rank.
+* @param sendcounts The number of elements sent to each rank.
+* @param type The MPI type of each element.
+* @param nrecv [OUT] The total number of elements received.
+* @param recvcounts [OUT] The number of elements received from each rank.
+*                   Optional, may be NULL.
+* @param comm The communicator to exchange among.
+*
+* @return The received elements, ordered by source rank. Must be freed!
+*/
+void * comm_exchange(
+    void const * const sendbuf,
+    int const * const sendcounts,
+    MPI_Datatype type,
+    int * nrecv,
+    int * recvcounts,
+    MPI_Comm comm);
+
+
+#define comm_pin_lookup zpart_comm_pin_lookup
+/**
+* @brief Find a per-vertex value for every local pin. Each rank only knows
+*        the values of the vertices it owns, so we route values through a
+*        directory which is block-distributed by vertex ID.
+*
+* @param hg The distributed hypergraph.
+* @param vals vals[v] is the value of local vertex 'v'.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return An array of length hg->nlocal_con with the value of each pin. Must
+*         be freed!
+*/
+int * comm_pin_lookup(
+    hgraph const * const hg,
+    int const * const vals,
+    MPI_Comm comm);
+
+#endif
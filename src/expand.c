@@ -0,0 +1,413 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "expand.h"
+#include "comm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+
+/**
+* @brief One directed edge, as gathered on the owner of its source.
+*/
+typedef struct
+{
+  int lid;   /** Local id of the source. */
+  idx_t gid; /** Global id of the destination. */
+  int proc;  /** Owner of the destination. */
+  float wgt;
+} adj_rec;
+
+
+/**
+* @brief Directed edges generated from my hyperedges, before they are sent to
+*        the owners of their sources.
+*/
+typedef struct
+{
+  int * dest;   /** Owner of the source of each edge. */
+  idx_t * trip; /** (source lid, destination gid, destination owner) */
+  float * wgts;
+  int nedges;
+  int maxedges;
+} edge_buf;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void __push_edge(
+    edge_buf * const buf,
+    int dest,
+    idx_t src_lid,
+    idx_t dst_gid,
+    int dst_proc,
+    float wgt)
+{
+  if(buf->nedges == buf->maxedges) {
+    buf->maxedges = (buf->maxedges == 0) ? 1024 : 2 * buf->maxedges;
+    buf->dest = (int *) realloc(buf->dest, buf->maxedges * sizeof(int));
+    buf->trip = (idx_t *) realloc(buf->trip,
+        3 * buf->maxedges * sizeof(idx_t));
+    buf->wgts = (float *) realloc(buf->wgts, buf->maxedges * sizeof(float));
+  }
+  int const e = buf->nedges++;
+  buf->dest[e] = dest;
+  buf->trip[3*e + 0] = src_lid;
+  buf->trip[3*e + 1] = dst_gid;
+  buf->trip[3*e + 2] = (idx_t) dst_proc;
+  buf->wgts[e] = wgt;
+}
+
+
+/**
+* @brief Hash a sample of a large hyperedge, so that the same input always
+*        expands into the same graph.
+*/
+static inline uint64_t __sample_hash(
+    uint64_t h,
+    uint64_t i,
+    uint64_t s)
+{
+  uint64_t x = (h * 0x9E3779B97F4A7C15ULL) ^ (i << 20) ^ s;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+
+static int __cmp_adj(
+    void const * a,
+    void const * b)
+{
+  adj_rec const * const x = (adj_rec const *) a;
+  adj_rec const * const y = (adj_rec const *) b;
+  if(x->lid != y->lid) {
+    return (x->lid < y->lid) ? -1 : 1;
+  }
+  if(x->gid != y->gid) {
+    return (x->gid < y->gid) ? -1 : 1;
+  }
+  return 0;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+egraph * expand_hgraph(
+    hgraph const * const hg,
+    expand_model model,
+    int cap,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  assert(model == EXPAND_STAR || model == EXPAND_CLIQUE);
+  if(cap < 2) {
+    cap = 2;
+  }
+
+  /* find the owner and local id of every pin */
+  int * vals = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vals[v] = rank;
+  }
+  int * pinowner = comm_pin_lookup(hg, vals, comm);
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vals[v] = v;
+  }
+  int * pinlid = comm_pin_lookup(hg, vals, comm);
+  free(vals);
+
+  int const nhnodes = (model == EXPAND_STAR) ? hg->nlocal_h : 0;
+  int const nlocal = hg->nlocal_v + nhnodes;
+
+  /* star edges out of my hyperedge vertices stay here */
+  adj_rec * local = NULL;
+  int nlocal_edges = 0;
+  if(model == EXPAND_STAR) {
+    local = (adj_rec *) malloc((hg->nlocal_con+1) * sizeof(adj_rec));
+  }
+
+  /* generate edges out of pins */
+  edge_buf buf = {NULL, NULL, NULL, 0, 0};
+  idx_t * scratch = hgraph_scratch(hg);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    int const start = hg->eptr[h];
+    int const k = hg->eptr[h+1] - start;
+
+    if(model == EXPAND_STAR) {
+      idx_t const hnode = hg->nglobal_v + hg->h_gids[h];
+      for(int i=0; i < k; ++i) {
+        __push_edge(&buf, pinowner[start+i], (idx_t) pinlid[start+i], hnode,
+            rank, 1.);
+        local[nlocal_edges].lid = hg->nlocal_v + h;
+        local[nlocal_edges].gid = pins[i];
+        local[nlocal_edges].proc = pinowner[start+i];
+        local[nlocal_edges].wgt = 1.;
+        ++nlocal_edges;
+      }
+      continue;
+    }
+
+    if(k < 2) {
+      continue;
+    }
+
+    if(k <= cap) {
+      /* full clique */
+      float const wgt = 1. / (float) (k-1);
+      for(int i=0; i < k; ++i) {
+        for(int j=0; j < k; ++j) {
+          if(pins[i] != pins[j]) {
+            __push_edge(&buf, pinowner[start+i], (idx_t) pinlid[start+i],
+                pins[j], pinowner[start+j], wgt);
+          }
+        }
+      }
+    } else {
+      /* each pin samples cap-1 neighbors, added in both directions */
+      float const wgt = 1. / (float) (2 * (cap-1));
+      for(int i=0; i < k; ++i) {
+        for(int s=0; s < cap-1; ++s) {
+          uint64_t const r = __sample_hash(hg->h_gids[h], i, s);
+          int const j = (i + 1 + (int) (r % (uint64_t) (k-1))) % k;
+          if(pins[i] == pins[j]) {
+            continue;
+          }
+          __push_edge(&buf, pinowner[start+i], (idx_t) pinlid[start+i],
+              pins[j], pinowner[start+j], wgt);
+          __push_edge(&buf, pinowner[start+j], (idx_t) pinlid[start+j],
+              pins[i], pinowner[start+i], wgt);
+        }
+      }
+    }
+  }
+  free(scratch);
+  free(pinowner);
+  free(pinlid);
+
+  /* send each edge to the owner of its source */
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * perm = comm_bucket(buf.dest, buf.nedges, sendcounts, comm);
+  idx_t * trip = (idx_t *) malloc((3*buf.nedges+1) * sizeof(idx_t));
+  float * wgts = (float *) malloc((buf.nedges+1) * sizeof(float));
+  for(int e=0; e < buf.nedges; ++e) {
+    memcpy(trip + 3*perm[e], buf.trip + 3*e, 3 * sizeof(idx_t));
+    wgts[perm[e]] = buf.wgts[e];
+  }
+  free(perm);
+  free(buf.dest);
+  free(buf.trip);
+  free(buf.wgts);
+
+  int nrecv;
+  float * rwgts = comm_exchange(wgts, sendcounts, MPI_FLOAT, &nrecv, NULL,
+      comm);
+  free(wgts);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 3;
+  }
+  int ntrip;
+  idx_t * rtrip = comm_exchange(trip, sendcounts, ZOLTAN_ID_MPI_TYPE, &ntrip,
+      NULL, comm);
+  free(trip);
+  free(sendcounts);
+  assert(ntrip == 3 * nrecv);
+
+  /* gather all of my edges, then merge parallel ones */
+  int const nedges = nrecv + nlocal_edges;
+  adj_rec * adj = (adj_rec *) malloc((nedges+1) * sizeof(adj_rec));
+  for(int e=0; e < nrecv; ++e) {
+    adj[e].lid = (int) rtrip[3*e + 0];
+    adj[e].gid = rtrip[3*e + 1];
+    adj[e].proc = (int) rtrip[3*e + 2];
+    adj[e].wgt = rwgts[e];
+    assert(adj[e].lid < hg->nlocal_v);
+  }
+  if(nlocal_edges > 0) {
+    memcpy(adj + nrecv, local, nlocal_edges * sizeof(adj_rec));
+  }
+  free(local);
+  free(rtrip);
+  free(rwgts);
+  qsort(adj, nedges, sizeof(adj_rec), __cmp_adj);
+
+  egraph * eg = (egraph *) malloc(sizeof(egraph));
+  eg->nlocal = nlocal;
+  eg->nvtxs = hg->nlocal_v;
+  eg->gids = (idx_t *) malloc((nlocal+1) * sizeof(idx_t));
+  eg->vwgts = (float *) malloc((nlocal+1) * sizeof(float));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    eg->gids[v] = hg->v_gids[v];
+    eg->vwgts[v] = 1.;
+  }
+  for(int h=0; h < nhnodes; ++h) {
+    eg->gids[hg->nlocal_v + h] = hg->nglobal_v + hg->h_gids[h];
+    eg->vwgts[hg->nlocal_v + h] = 0.;
+  }
+
+  eg->xadj = (int *) calloc(nlocal+1, sizeof(int));
+  eg->adjncy = (idx_t *) malloc((nedges+1) * sizeof(idx_t));
+  eg->adjproc = (int *) malloc((nedges+1) * sizeof(int));
+  eg->adjwgt = (float *) malloc((nedges+1) * sizeof(float));
+  int nnz = 0;
+  for(int e=0; e < nedges; ++e) {
+    if(nnz > 0 && e > 0 && adj[e].lid == adj[e-1].lid &&
+        adj[e].gid == adj[e-1].gid) {
+      eg->adjwgt[nnz-1] += adj[e].wgt;
+      continue;
+    }
+    eg->adjncy[nnz] = adj[e].gid;
+    eg->adjproc[nnz] = adj[e].proc;
+    eg->adjwgt[nnz] = adj[e].wgt;
+    ++eg->xadj[adj[e].lid + 1];
+    ++nnz;
+  }
+  free(adj);
+  for(int v=0; v < nlocal; ++v) {
+    eg->xadj[v+1] += eg->xadj[v];
+  }
+  assert(eg->xadj[nlocal] == nnz);
+
+  return eg;
+}
+
+
+void egraph_free(
+    egraph * const eg)
+{
+  free(eg->gids);
+  free(eg->vwgts);
+  free(eg->xadj);
+  free(eg->adjncy);
+  free(eg->adjproc);
+  free(eg->adjwgt);
+  free(eg);
+}
+
+
+
+/******************************************************************************
+ * QUERY FUNCTIONS
+ *****************************************************************************/
+int eg_get_nobj(
+    void * data,
+    int * ierr)
+{
+  egraph const * const eg = (egraph *) data;
+  *ierr = ZOLTAN_OK;
+  return eg->nlocal;
+}
+
+
+void eg_get_olist(
+    void * data,
+    int gid_size,
+    int lid_size,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int wt_size,
+    float * obj_wts,
+    int * ierr)
+{
+  egraph const * const eg = (egraph *) data;
+  *ierr = ZOLTAN_OK;
+
+  for(int v=0; v < eg->nlocal; ++v) {
+    gids[v] = eg->gids[v];
+  }
+  if(lid_size > 0 && lids != NULL) {
+    for(int v=0; v < eg->nlocal; ++v) {
+      lids[v] = v;
+    }
+  }
+  if(wt_size > 0 && obj_wts != NULL) {
+    for(int v=0; v < eg->nlocal; ++v) {
+      for(int w=0; w < wt_size; ++w) {
+        obj_wts[(v * wt_size) + w] = eg->vwgts[v];
+      }
+    }
+  }
+}
+
+
+void eg_get_nedges(
+    void * data,
+    int gid_size,
+    int lid_size,
+    int nobjs,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int * nedges,
+    int * ierr)
+{
+  egraph const * const eg = (egraph *) data;
+  *ierr = ZOLTAN_OK;
+
+  for(int i=0; i < nobjs; ++i) {
+    idx_t const v = lids[i * lid_size];
+    if(v >= (idx_t) eg->nlocal) {
+      *ierr = ZOLTAN_FATAL;
+      return;
+    }
+    nedges[i] = eg->xadj[v+1] - eg->xadj[v];
+  }
+}
+
+
+void eg_get_elist(
+    void * data,
+    int gid_size,
+    int lid_size,
+    int nobjs,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int * nedges,
+    ZOLTAN_ID_PTR nbor_gids,
+    int * nbor_procs,
+    int wt_size,
+    float * edge_wts,
+    int * ierr)
+{
+  egraph const * const eg = (egraph *) data;
+  *ierr = ZOLTAN_OK;
+
+  int n = 0;
+  for(int i=0; i < nobjs; ++i) {
+    idx_t const v = lids[i * lid_size];
+    if(v >= (idx_t) eg->nlocal ||
+        nedges[i] != eg->xadj[v+1] - eg->xadj[v]) {
+      *ierr = ZOLTAN_FATAL;
+      return;
+    }
+    for(int e=eg->xadj[v]; e < eg->xadj[v+1]; ++e) {
+      nbor_gids[n * gid_size] = eg->adjncy[e];
+      nbor_procs[n] = eg->adjproc[e];
+      for(int w=0; w < wt_size; ++w) {
+        edge_wts[(n * wt_size) + w] = eg->adjwgt[e];
+      }
+      ++n;
+    }
+  }
+}
@@ -0,0 +1,138 @@
+#ifndef ZPART_EXPAND_H
+#define ZPART_EXPAND_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+#define expand_model zpart_expand_model
+/**
+* @brief Graph models of a hypergraph.
+*/
+typedef enum
+{
+  EXPAND_NONE,   /** Partition the hypergraph itself. */
+  EXPAND_STAR,   /** Each hyperedge becomes a zero-weight vertex. */
+  EXPAND_CLIQUE  /** Each hyperedge becomes a (sampled) weighted clique. */
+} expand_model;
+
+
+#define egraph zpart_egraph
+/**
+* @brief A distributed graph expanded from a hypergraph. Each rank owns the
+*        vertices it owns in the hypergraph, followed by the hyperedge
+*        vertices of its hyperedges under the star model.
+*/
+typedef struct
+{
+  int nlocal;   /** The number of local objects. */
+  int nvtxs;    /** The first 'nvtxs' objects are hypergraph vertices. */
+
+  ZOLTAN_ID_TYPE * gids; /** Global id's of my objects. */
+  float * vwgts;         /** Weight of each object. */
+
+  int * xadj;   /** xadj[v]:xadj[v+1] index into the adjacency of 'v' */
+  ZOLTAN_ID_TYPE * adjncy; /** Global id's of neighbors. */
+  int * adjproc;           /** Rank owning each neighbor. */
+  float * adjwgt;          /** Weight of each edge. */
+} egraph;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define expand_hgraph zpart_expand_hgraph
+/**
+* @brief Expand a distributed hypergraph into a graph. The star model adds
+*        one vertex per hyperedge (with global id nglobal_v + h) connected to
+*        each of its pins. The clique model connects every pair of pins with
+*        weight 1/(k-1); hyperedges with more than 'cap' pins instead connect
+*        each pin to cap-1 pseudo-randomly sampled pins, so that each pin
+*        keeps about the same total weight. Edges are generated by the rank
+*        holding the hyperedge and sent to the owners of their endpoints,
+*        where parallel edges are merged.
+*
+* @param hg The distributed hypergraph.
+* @param model EXPAND_STAR or EXPAND_CLIQUE.
+* @param cap The largest hyperedge expanded into a full clique.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return The expanded graph. Must be freed with egraph_free()!
+*/
+egraph * expand_hgraph(
+    hgraph const * const hg,
+    expand_model model,
+    int cap,
+    MPI_Comm comm);
+
+
+#define egraph_free zpart_egraph_free
+/**
+* @brief Free all memory allocated by expand_hgraph().
+*
+* @param eg The graph to free.
+*/
+void egraph_free(
+    egraph * const eg);
+
+
+
+/******************************************************************************
+ * QUERY FUNCTIONS
+ *****************************************************************************/
+#define eg_get_nobj zpart_eg_get_nobj
+int eg_get_nobj(
+    void * data,
+    int * ierr);
+
+
+#define eg_get_olist zpart_eg_get_olist
+void eg_get_olist(
+    void * data,
+    int gid_size,
+    int lid_size,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int wt_size,
+    float * obj_wts,
+    int * ierr);
+
+
+#define eg_get_nedges zpart_eg_get_nedges
+void eg_get_nedges(
+    void * data,
+    int gid_size,
+    int lid_size,
+    int nobjs,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int * nedges,
+    int * ierr);
+
+
+#define eg_get_elist zpart_eg_get_elist
+void eg_get_elist(
+    void * data,
+    int gid_size,
+    int lid_size,
+    int nobjs,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int * nedges,
+    ZOLTAN_ID_PTR nbor_gids,
+    int * nbor_procs,
+    int wt_size,
+    float * edge_wts,
+    int * ierr);
+
+#endif
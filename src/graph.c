@@ -3,9 +3,12 @@
  * INCLUDES
  *****************************************************************************/
 #include "graph.h"
+#include "comm.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include <ctype.h>
 #include <mpi.h>
@@ -18,6 +21,14 @@
 
 static int const DEF_TAG = 0;
 
+/* the most pins a rank may hold under the vertex layout, relative to the
+ * average, before hgraph_choose_layout() falls back to the edge layout */
+static double const LAYOUT_MAX_IMBALANCE = 1.25;
+
+/* hgraph_choose_layout() only considers the vertex layout when there are at
+ * least this many times more hyperedges than vertices */
+static double const LAYOUT_MIN_RATIO = 2.0;
+
 /******************************************************************************
  * STATIC FUNCTIONS
  *****************************************************************************/
@@ -48,7 +59,8 @@ static void __rstrip_line(
 * @param fin The file to read from.
 * @param nvals [OUT] Pointer to the length of the returned array.
 *
-* @return The allocated array of idx_t, which must be freed!
+* @return The allocated array of idx_t, which must be freed! NULL at the end
+*         of input.
 */
 static idx_t * __split_line(
     FILE * fin,
@@ -63,9 +75,8 @@ static idx_t * __split_line(
     free(line);
     nread = getline(&line, &len, fin);
     if(nread == -1) {
-      fprintf(stderr, "ZPART: unexpected end of input.\n");
-      MPI_Finalize();
-      exit(1);
+      free(line);
+      return NULL;
     }
   } while(line[0] == '#' || line[0] == '%'); /* skip comment lines */
 
@@ -78,16 +89,16 @@ static idx_t * __split_line(
 
   /* now count values */
   int count = 0;
-  char * ptr = strtok(line_tmp, " \t");
+  char * ptr = strtok(line_tmp, " \t\r\n");
   while(ptr != NULL) {
     count += 1;
-    ptr = strtok(NULL, " \t");
+    ptr = strtok(NULL, " \t\r\n");
   }
   free(line_tmp);
 
   ptr = line;
-  /* allocate and fill array */
-  idx_t * arr = (idx_t *) malloc(count * sizeof(idx_t));
+  /* allocate and fill array; +1 so an empty line never mallocs 0 */
+  idx_t * arr = (idx_t *) malloc((count+1) * sizeof(idx_t));
   for(int i=0; i < count; ++i) {
     arr[i] = (idx_t) strtoll(ptr, &ptr, 10);
   }
@@ -107,11 +118,11 @@ static idx_t * __split_line(
 * @param bsize The new size of buf (in #entries).
 * @param ncon We add the number of connections (#entries read).
 *
-* @return The (possibly resized) buffer.
+* @return 1 on success, 0 at the end of input.
 */
-static idx_t *  __accum_line(
+static int __accum_line(
     FILE * fin,
-    idx_t * buf,
+    idx_t ** buf,
     int * next_len,
     size_t * bsize,
     idx_t * ncon)
@@ -119,17 +130,118 @@ static idx_t *  __accum_line(
   /* get next array */
   int len;
   idx_t * arr = __split_line(fin, &len);
+  if(arr == NULL) {
+    return 0;
+  }
 
   /* store length */
   *next_len = len;
   *ncon += len;
 
-  buf = (idx_t *) realloc(buf, (*bsize+len) * sizeof(idx_t));
-  memcpy(buf + (*bsize), arr, len * sizeof(idx_t));
+  *buf = (idx_t *) realloc(*buf, (*bsize+len) * sizeof(idx_t));
+  memcpy(*buf + (*bsize), arr, len * sizeof(idx_t));
   *bsize += (size_t) len;
 
   free(arr);
-  return buf;
+  return 1;
+}
+
+
+/**
+* @brief Lexicographic comparison of idx_t pairs for qsort().
+*/
+static int __cmp_pair(
+    void const * a,
+    void const * b)
+{
+  idx_t const * const x = (idx_t const *) a;
+  idx_t const * const y = (idx_t const *) b;
+  for(int i=0; i < 2; ++i) {
+    if(x[i] != y[i]) {
+      return (x[i] < y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+* @brief Find the local ID of a vertex in a sorted list of (gid, lid) pairs.
+*
+* @param vmap The sorted pairs.
+* @param n The number of pairs.
+* @param gid The global ID to search for.
+*
+* @return The local ID.
+*/
+static int __find_lid(
+    idx_t const * const vmap,
+    int n,
+    idx_t const gid)
+{
+  int lo = 0;
+  int hi = n;
+  while(lo < hi) {
+    int const mid = lo + ((hi - lo) / 2);
+    if(vmap[2*mid] < gid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  assert(lo < n && vmap[2*lo] == gid);
+  return (int) vmap[2*lo + 1];
+}
+
+
+static int __cmp_idx(
+    void const * a,
+    void const * b)
+{
+  idx_t const x = *(idx_t const *) a;
+  idx_t const y = *(idx_t const *) b;
+  return (x < y) ? -1 : (x > y);
+}
+
+
+/**
+* @brief Return the number of bytes needed to store 'val' as a varint.
+*/
+static int __varint_len(
+    uint64_t val)
+{
+  int len = 1;
+  while(val >= 0x80) {
+    val >>= 7;
+    ++len;
+  }
+  return len;
+}
+
+
+/**
+* @brief Return the number of bits needed for the largest delta between
+*        consecutive sorted pins.
+*/
+static int __delta_width(
+    idx_t const * const pins,
+    int npins)
+{
+  idx_t maxdelta = 0;
+  for(int n=1; n < npins; ++n) {
+    idx_t const delta = pins[n] - pins[n-1];
+    if(delta > maxdelta) {
+      maxdelta = delta;
+    }
+  }
+  int width = 0;
+  while(maxdelta > 0) {
+    maxdelta >>= 1;
+    ++width;
+  }
+  /* keep a delta within one unaligned 64-bit load */
+  assert(width <= 56);
+  return width;
 }
 
 
@@ -139,32 +251,37 @@ static idx_t *  __accum_line(
 * @param fname The file to read from.
 * @param comm The communicator to distribute among.
 *
-* @return My own chunk of the hypergraph.
+* @return My own chunk of the hypergraph, or NULL if the file could not be
+*         read. Every other rank is told before it waits for its chunk.
 */
 static hgraph * __send_graph(
     char const * const fname,
     MPI_Comm comm)
 {
-  FILE * fin;
-  if((fin = fopen(fname, "r")) == NULL) {
-    fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
-    MPI_Finalize();
-    exit(1);
-  }
-
   int npes;
   MPI_Comm_size(comm, &npes);
 
-  /* get global dims */
-  int len;
-  idx_t * dims = __split_line(fin, &len);
-  if(len != 2) {
+  /* get global dims; a length of 0 tells everyone to give up */
+  int len = 0;
+  idx_t * dims = NULL;
+  FILE * fin;
+  if((fin = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
+  } else if((dims = __split_line(fin, &len)) == NULL) {
+    fprintf(stderr, "ZPART: unexpected end of input in '%s'\n", fname);
+  } else if(len != 2) {
     fprintf(stderr, "ZPART: only unweighted graphs supported right now.\n");
-    MPI_Finalize();
-    exit(1);
   }
   /* only handle unweighted right now, otherwise dims[3] would be fmt */
-  assert(len == 2);
+  if(dims == NULL || len != 2) {
+    len = 0;
+    MPI_Bcast(&len, 1, MPI_INT, 0, comm);
+    free(dims);
+    if(fin != NULL) {
+      fclose(fin);
+    }
+    return NULL;
+  }
 
   /* send global dims */
   MPI_Bcast(&len, 1, MPI_INT, 0, comm);
@@ -172,6 +289,7 @@ static hgraph * __send_graph(
 
   idx_t const nhedges = dims[0];
   idx_t const nvtxs   = dims[1];
+  free(dims);
 
   idx_t * buf = NULL;
   size_t bsize = 0;
@@ -181,12 +299,18 @@ static hgraph * __send_graph(
   idx_t * vids = (idx_t *) malloc(vtarget * sizeof(idx_t));
   idx_t * hids = (idx_t *) malloc(htarget * sizeof(idx_t));
   int * lengths = (int *) malloc(htarget * sizeof(int));
-  /* read a chunk, send a chunk */
+  /* read a chunk, send a chunk; each chunk is preceded by whether the file
+   * held it, and once it did not, the remaining ranks are only told so */
+  int ok = 1;
   for(int p=1; p < npes; ++p) {
     idx_t ncon = 0;
     /* accumulate each row into buf */
-    for(int h=0; h < htarget; ++h) {
-      buf = __accum_line(fin, buf, lengths + h, &bsize, &ncon);
+    for(int h=0; ok && h < htarget; ++h) {
+      ok = __accum_line(fin, &buf, lengths + h, &bsize, &ncon);
+    }
+    MPI_Send(&ok, 1, MPI_INT, p, DEF_TAG, comm);
+    if(!ok) {
+      continue;
     }
 
     /* zero-index buf */
@@ -236,8 +360,15 @@ static hgraph * __send_graph(
   idx_t ncon = 0;
   idx_t vstart = (npes-1) * vtarget;
   idx_t hstart = (npes-1) * htarget;
-  for(idx_t h=hstart; h < nhedges; ++h) {
-    buf = __accum_line(fin, buf, lengths + (h-hstart), &bsize, &ncon);
+  for(idx_t h=hstart; ok && h < nhedges; ++h) {
+    ok = __accum_line(fin, &buf, lengths + (h-hstart), &bsize, &ncon);
+  }
+  if(!ok) {
+    fprintf(stderr, "ZPART: unexpected end of input in '%s'\n", fname);
+    free(buf);
+    free(lengths);
+    fclose(fin);
+    return NULL;
   }
   /* zero-index buf */
   for(idx_t b=0; b < bsize; ++b) {
@@ -245,6 +376,8 @@ static hgraph * __send_graph(
   }
 
   hgraph * hg = hgraph_alloc(local_vtxs, local_hedges, ncon);
+  hg->nglobal_v = nvtxs;
+  hg->nglobal_h = nhedges;
   hg->nlocal_v = local_vtxs;
   hg->nlocal_h = local_hedges;
 
@@ -282,7 +415,7 @@ static hgraph * __send_graph(
 * @param rank My rank in the communicator.
 * @param comm The communicator I am in.
 *
-* @return My chunk of the hypergraph.
+* @return My chunk of the hypergraph, or NULL if rank 0 could not read it.
 */
 static hgraph * __recv_graph(
     int rank,
@@ -291,6 +424,9 @@ static hgraph * __recv_graph(
   /* receive global dims */
   int len;
   MPI_Bcast(&len, 1, MPI_INT, 0, comm);
+  if(len == 0) {
+    return NULL;
+  }
   idx_t * dims = (idx_t *) malloc(len * sizeof(idx_t));
   MPI_Bcast(dims, len, ZOLTAN_ID_MPI_TYPE, 0, comm);
 
@@ -300,6 +436,13 @@ static hgraph * __recv_graph(
 
   MPI_Status status;
 
+  /* was my chunk in the file? */
+  int ok;
+  MPI_Recv(&ok, 1, MPI_INT, 0, DEF_TAG, comm, &status);
+  if(!ok) {
+    return NULL;
+  }
+
   /* receive sizes */
   int local_vtxs;
   int local_hedges;
@@ -343,22 +486,131 @@ static hgraph * __recv_graph(
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
+long long hgraph_validate(
+    hgraph * const hg,
+    validate_mode validate,
+    long long ndropped,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  /* out of range, duplicates, empty */
+  long long counts[3] = {ndropped, 0, 0};
+  int const clean = (validate == VALIDATE_CLEAN);
+
+  int nnz = 0;
+  int nh = 0;
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    int const start = hg->eptr[h];
+    int const end = hg->eptr[h+1];
+    int const hstart = nnz;
+
+    qsort(hg->eind + start, end - start, sizeof(idx_t), __cmp_idx);
+
+    for(int n=start; n < end; ++n) {
+      idx_t const v = hg->eind[n];
+      /* pins of 0 wrap around after zero-indexing */
+      if(v >= hg->nglobal_v) {
+        ++counts[0];
+        continue;
+      }
+      if(n > start && v == hg->eind[n-1]) {
+        ++counts[1];
+        continue;
+      }
+      if(clean) {
+        hg->eind[nnz] = v;
+      }
+      ++nnz;
+    }
+
+    if(nnz == hstart) {
+      ++counts[2];
+      if(clean) {
+        continue;
+      }
+    }
+    if(clean) {
+      hg->h_gids[nh] = hg->h_gids[h];
+      hg->eptr[nh] = hstart;
+    }
+    ++nh;
+  }
+
+  if(clean) {
+    hg->eptr[nh] = nnz;
+    hg->nlocal_h = nh;
+    hg->nlocal_con = nnz;
+  }
+
+  long long gcounts[3];
+  MPI_Reduce(counts, gcounts, 3, MPI_LONG_LONG, MPI_SUM, 0, comm);
+  long long total = 0;
+  if(rank == 0) {
+    printf("Validation: %lld out-of-range pins, %lld duplicate pins, "
+        "%lld empty hyperedges%s\n", gcounts[0], gcounts[1], gcounts[2],
+        clean ? " (removed)" : "");
+    total = gcounts[0] + gcounts[1] + gcounts[2];
+  }
+  MPI_Bcast(&total, 1, MPI_LONG_LONG, 0, comm);
+  return total;
+}
+
+
 hgraph * distribute_hgraph(
     char const * const fname,
+    validate_mode validate,
     MPI_Comm comm)
 {
   int rank;
   MPI_Comm_rank(comm, &rank);
 
+  hgraph * hg;
   if(rank == 0) {
-    return __send_graph(fname, comm);
+    hg = __send_graph(fname, comm);
   } else {
-    return __recv_graph(rank, comm);
+    hg = __recv_graph(rank, comm);
   }
 
-  return NULL;
+  /* ranks which got their chunk before the file ran out give up too */
+  int ok = (hg != NULL);
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+  if(!ok) {
+    if(hg != NULL) {
+      hgraph_free(hg);
+    }
+    return NULL;
+  }
+
+  return hgraph_check(hg, fname, validate, 0, comm);
 }
 
+hgraph * hgraph_check(
+    hgraph * const hg,
+    char const * const fname,
+    validate_mode validate,
+    long long ndropped,
+    MPI_Comm comm)
+{
+  if(validate == VALIDATE_OFF) {
+    return hg;
+  }
+
+  long long const nbad = hgraph_validate(hg, validate, ndropped, comm);
+  if(validate == VALIDATE_STRICT && nbad > 0) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if(rank == 0) {
+      fprintf(stderr, "ZPART: '%s' is not a valid hypergraph.\n", fname);
+    }
+    hgraph_free(hg);
+    return NULL;
+  }
+  return hg;
+}
+
+
 hgraph * hgraph_alloc(
     int local_vtxs,
     int local_hedges,
@@ -376,6 +628,13 @@ hgraph * hgraph_alloc(
   hg->eptr = (int *) malloc((local_hedges+1) * sizeof(int));
   hg->eind = (idx_t *) malloc(local_connections * sizeof(idx_t));
 
+  hg->layout = ZOLTAN_COMPRESSED_EDGE;
+  hg->nlocal_vcon = 0;
+  hg->vptr = NULL;
+  hg->vind = NULL;
+  hg->cind = NULL;
+  hg->cptr = NULL;
+
   return hg;
 }
 
@@ -387,10 +646,296 @@ void hgraph_free(
   free(hg->v_gids);
   free(hg->h_gids);
   free(hg->eind);
+  free(hg->vptr);
+  free(hg->vind);
+  free(hg->cind);
+  free(hg->cptr);
   free(hg);
 }
 
 
+void hgraph_compress(
+    hgraph * const hg)
+{
+  if(hg->cind != NULL) {
+    return;
+  }
+
+  /* first pass: sort pins and size each hyperedge */
+  hg->cptr = (size_t *) malloc((hg->nlocal_h+1) * sizeof(size_t));
+  hg->cptr[0] = 0;
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t * const pins = hg->eind + hg->eptr[h];
+    int const npins = hg->eptr[h+1] - hg->eptr[h];
+    qsort(pins, npins, sizeof(idx_t), __cmp_idx);
+
+    size_t bytes = 0;
+    if(npins > 0) {
+      int const width = __delta_width(pins, npins);
+      bytes = __varint_len(pins[0]) + 1 +
+          ((((size_t) (npins-1) * width) + 7) / 8);
+    }
+    hg->cptr[h+1] = hg->cptr[h] + bytes;
+  }
+
+  /* second pass: encode; pad so decoding may always load 8 bytes */
+  hg->cind = (unsigned char *) calloc(hg->cptr[hg->nlocal_h] + 8, 1);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg->eind + hg->eptr[h];
+    int const npins = hg->eptr[h+1] - hg->eptr[h];
+    if(npins == 0) {
+      continue;
+    }
+    unsigned char * out = hg->cind + hg->cptr[h];
+
+    /* first pin as a varint */
+    uint64_t first = (uint64_t) pins[0];
+    while(first >= 0x80) {
+      *(out++) = (unsigned char) (first | 0x80);
+      first >>= 7;
+    }
+    *(out++) = (unsigned char) first;
+
+    /* then the bit-packed deltas */
+    int const width = __delta_width(pins, npins);
+    *(out++) = (unsigned char) width;
+    uint64_t acc = 0;
+    int nbits = 0;
+    for(int n=1; n < npins; ++n) {
+      acc |= ((uint64_t) (pins[n] - pins[n-1])) << nbits;
+      nbits += width;
+      while(nbits >= 8) {
+        *(out++) = (unsigned char) acc;
+        acc >>= 8;
+        nbits -= 8;
+      }
+    }
+    if(nbits > 0) {
+      *(out++) = (unsigned char) acc;
+    }
+    assert(out == hg->cind + hg->cptr[h+1]);
+  }
+
+  free(hg->eind);
+  hg->eind = NULL;
+}
+
+
+void hgraph_decode(
+    hgraph const * const hg,
+    int h,
+    idx_t * const pins)
+{
+  int const npins = hg->eptr[h+1] - hg->eptr[h];
+  if(npins == 0) {
+    return;
+  }
+  unsigned char const * in = hg->cind + hg->cptr[h];
+
+  uint64_t first = 0;
+  int shift = 0;
+  while(*in & 0x80) {
+    first |= ((uint64_t) (*(in++) & 0x7f)) << shift;
+    shift += 7;
+  }
+  first |= ((uint64_t) *(in++)) << shift;
+
+  int const width = *(in++);
+  uint64_t const mask = (width == 0) ? 0 : (~0ULL >> (64 - width));
+
+  idx_t prev = (idx_t) first;
+  pins[0] = prev;
+  for(int n=1; n < npins; ++n) {
+    size_t const bit = (size_t) (n-1) * width;
+    uint64_t word;
+    memcpy(&word, in + (bit >> 3), sizeof(word));
+    prev += (idx_t) ((word >> (bit & 7)) & mask);
+    pins[n] = prev;
+  }
+}
+
+
+idx_t * hgraph_scratch(
+    hgraph const * const hg)
+{
+  int maxlen = 0;
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    int const len = hg->eptr[h+1] - hg->eptr[h];
+    if(len > maxlen) {
+      maxlen = len;
+    }
+  }
+  return (idx_t *) malloc((maxlen+1) * sizeof(idx_t));
+}
+
+
+void hgraph_transpose(
+    hgraph * const hg,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  /* find the owner of each pin's vertex */
+  int * vranks = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vranks[v] = rank;
+  }
+  int * pinranks = comm_pin_lookup(hg, vranks, comm);
+  free(vranks);
+
+  /* ship (vtx, hedge) pairs to the vertex owners */
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * perm = comm_bucket(pinranks, hg->nlocal_con, sendcounts, comm);
+  free(pinranks);
+  idx_t * sendbuf = (idx_t *) malloc((2*hg->nlocal_con+1) * sizeof(idx_t));
+  idx_t * scratch = hgraph_scratch(hg);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      sendbuf[2*perm[n] + 0] = pins[n - hg->eptr[h]];
+      sendbuf[2*perm[n] + 1] = hg->h_gids[h];
+    }
+  }
+  free(scratch);
+  free(perm);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nrecv;
+  idx_t * recv = comm_exchange(sendbuf, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nrecv, NULL, comm);
+  free(sendbuf);
+  free(sendcounts);
+  nrecv /= 2;
+
+  /* local vertex IDs, ordered by global ID for lookups */
+  idx_t * vmap = (idx_t *) malloc((2*hg->nlocal_v+1) * sizeof(idx_t));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vmap[2*v + 0] = hg->v_gids[v];
+    vmap[2*v + 1] = (idx_t) v;
+  }
+  qsort(vmap, hg->nlocal_v, 2 * sizeof(idx_t), __cmp_pair);
+
+  /* counting sort into CSR */
+  int * lids = (int *) malloc((nrecv+1) * sizeof(int));
+  free(hg->vptr);
+  free(hg->vind);
+  hg->vptr = (int *) calloc(hg->nlocal_v+1, sizeof(int));
+  hg->vind = (idx_t *) malloc((nrecv+1) * sizeof(idx_t));
+  for(int n=0; n < nrecv; ++n) {
+    lids[n] = __find_lid(vmap, hg->nlocal_v, recv[2*n]);
+    ++hg->vptr[lids[n] + 1];
+  }
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    hg->vptr[v+1] += hg->vptr[v];
+  }
+  for(int n=0; n < nrecv; ++n) {
+    hg->vind[hg->vptr[lids[n]]++] = recv[2*n + 1];
+  }
+  /* shift pointers back */
+  for(int v=hg->nlocal_v; v > 0; --v) {
+    hg->vptr[v] = hg->vptr[v-1];
+  }
+  hg->vptr[0] = 0;
+
+  free(lids);
+  free(vmap);
+  free(recv);
+
+  hg->nlocal_vcon = nrecv;
+  hg->layout = ZOLTAN_COMPRESSED_VERTEX;
+}
+
+
+long long hgraph_cut(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm,
+    long long * cutnets)
+{
+  int * pinparts = comm_pin_lookup(hg, parts, comm);
+
+  /* last[p] is the last hyperedge found to touch part 'p' */
+  int * last = (int *) malloc(nparts * sizeof(int));
+  for(int p=0; p < nparts; ++p) {
+    last[p] = -1;
+  }
+
+  long long cut[2] = {0, 0};
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    int lambda = 0;
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      int const p = pinparts[n];
+      if(last[p] != h) {
+        last[p] = h;
+        ++lambda;
+      }
+    }
+    if(lambda > 1) {
+      cut[0] += lambda - 1;
+      ++cut[1];
+    }
+  }
+  free(last);
+  free(pinparts);
+
+  MPI_Allreduce(MPI_IN_PLACE, cut, 2, MPI_LONG_LONG, MPI_SUM, comm);
+  *cutnets = cut[1];
+  return cut[0];
+}
+
+
+int hgraph_choose_layout(
+    hgraph const * const hg,
+    MPI_Comm comm)
+{
+  if((double) hg->nglobal_h < LAYOUT_MIN_RATIO * (double) hg->nglobal_v) {
+    return ZOLTAN_COMPRESSED_EDGE;
+  }
+
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  /* count how many pins each rank would own under the vertex layout */
+  int * vranks = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vranks[v] = rank;
+  }
+  int * pinranks = comm_pin_lookup(hg, vranks, comm);
+  free(vranks);
+
+  long long * counts = (long long *) calloc(npes, sizeof(long long));
+  for(int n=0; n < hg->nlocal_con; ++n) {
+    ++counts[pinranks[n]];
+  }
+  free(pinranks);
+
+  long long * totals = (long long *) malloc(npes * sizeof(long long));
+  MPI_Allreduce(counts, totals, npes, MPI_LONG_LONG, MPI_SUM, comm);
+
+  long long maxpins = 0;
+  long long sumpins = 0;
+  for(int p=0; p < npes; ++p) {
+    sumpins += totals[p];
+    if(totals[p] > maxpins) {
+      maxpins = totals[p];
+    }
+  }
+  free(counts);
+  free(totals);
+
+  double const avg = (double) sumpins / (double) npes;
+  if(sumpins > 0 && (double) maxpins > LAYOUT_MAX_IMBALANCE * avg) {
+    return ZOLTAN_COMPRESSED_EDGE;
+  }
+  return ZOLTAN_COMPRESSED_VERTEX;
+}
+
+
 
 /******************************************************************************
  * QUERY FUNCTIONS
@@ -440,10 +985,15 @@ void hg_get_netsizes(
   hgraph const * const hg = (hgraph *) data;
   *ierr = ZOLTAN_OK;
 
-  /* fill in hedge sizes */
-  *num_lists = hg->nlocal_h;
-  *num_nonzeroes = hg->nlocal_con;
-  *format = ZOLTAN_COMPRESSED_EDGE;
+  /* fill in list sizes */
+  if(hg->layout == ZOLTAN_COMPRESSED_VERTEX) {
+    *num_lists = hg->nlocal_v;
+    *num_nonzeroes = hg->nlocal_vcon;
+  } else {
+    *num_lists = hg->nlocal_h;
+    *num_nonzeroes = hg->nlocal_con;
+  }
+  *format = hg->layout;
 }
 
 
@@ -464,8 +1014,28 @@ void hg_get_hlist(
   assert(gid_size == 1);
 
   /* sanity check */
-  if((nhedges != hg->nlocal_h) || (ncon != hg->nlocal_con) ||
-       (format != ZOLTAN_COMPRESSED_EDGE)) {
+  if(format != hg->layout) {
+    *ierr = ZOLTAN_FATAL;
+    return;
+  }
+
+  if(format == ZOLTAN_COMPRESSED_VERTEX) {
+    if((nhedges != hg->nlocal_v) || (ncon != hg->nlocal_vcon)) {
+      *ierr = ZOLTAN_FATAL;
+      return;
+    }
+    /* lists are vertices and pins are hyperedges */
+    for(int v=0; v < nhedges; ++v) {
+      h_gids[v] = hg->v_gids[v];
+      eptr[v] = hg->vptr[v];
+    }
+    for(int n=0; n < ncon; ++n) {
+      eind[n] = hg->vind[n];
+    }
+    return;
+  }
+
+  if((nhedges != hg->nlocal_h) || (ncon != hg->nlocal_con)) {
     *ierr = ZOLTAN_FATAL;
     return;
   }
@@ -480,11 +1050,15 @@ void hg_get_hlist(
   memcpy(eptr, hg->eptr, nhedges * sizeof(int));
 #endif
 
-  /* fill in eind */
+  /* fill in eind, decoding straight into Zoltan's buffer if compressed */
+  if(hg->cind != NULL) {
+    for(int h=0; h < nhedges; ++h) {
+      hgraph_decode(hg, h, eind + hg->eptr[h]);
+    }
+    return;
+  }
   //memcpy(eind, hg->eind, ncon * sizeof(ZOLTAN_ID_TYPE));
   for(int n=0; n < ncon; ++n) {
     eind[n] = hg->eind[n];
   }
 }
-
-
@@ -6,6 +6,7 @@
  * INCLUDES
  *****************************************************************************/
 
+#include <stddef.h>
 #include <zoltan.h>
 
 
@@ -32,6 +33,18 @@ typedef struct
   ZOLTAN_ID_TYPE * h_gids;  /** Global id's of local hedges. */
   ZOLTAN_ID_TYPE * eind;    /** Global id's of local vertices, per hedge. */
 
+  /* Optional vertex-major transpose, built by hgraph_transpose(). Pins are
+   * co-located with the owner of their vertex. */
+  int layout;     /** ZOLTAN_COMPRESSED_EDGE or ZOLTAN_COMPRESSED_VERTEX. */
+  int nlocal_vcon;/** Sum of hedges in all local vertices. */
+  int * vptr;     /** vptr[v]:vptr[v+1] index into vind for vertex 'v' */
+  ZOLTAN_ID_TYPE * vind;    /** Global id's of hedges, per local vertex. */
+
+  /* Optional compressed pins, built by hgraph_compress(). When present, eind
+   * is NULL and pins must be read through hg_pins(). */
+  unsigned char * cind; /** Delta + bit-packed pins of each hedge. */
+  size_t * cptr;  /** cptr[h]:cptr[h+1] index into cind for hedge 'h' */
+
 #if 0
   int numMyVertices;  /* number of vertices that I own initially */
   ZOLTAN_ID_TYPE *vtxGID;        /* global ID of these vertices */
@@ -46,21 +59,82 @@ typedef struct
 
 
 
+#define validate_mode zpart_validate_mode
+/**
+* @brief How input problems are handled while distributing a hypergraph. We
+*        look for out-of-range pins, duplicate pins within a hyperedge, and
+*        empty hyperedges.
+*/
+typedef enum
+{
+  VALIDATE_OFF,    /** Do not check the input. */
+  VALIDATE_CLEAN,  /** Remove bad pins and empty hyperedges, report counts. */
+  VALIDATE_STRICT  /** Report counts and fail on any problem. */
+} validate_mode;
+
+
+
 /******************************************************************************
  * PUBLIC FUNCTIONS
  *****************************************************************************/
 
 #define distribute_hgraph zpart_disribute_hgraph
 /**
-* @brief Load a hypergraph and distribute it among processes.
+* @brief Load a hypergraph and distribute it among processes. Each rank
+*        validates its own chunk after receiving it.
 *
 * @param fname The file to read from.
+* @param validate How to handle input problems.
 * @param comm The MPI communicator to distribute among.
 *
 * @return My owned hgraph. NULL on error.
 */
 hgraph * distribute_hgraph(
     char const * const fname,
+    validate_mode validate,
+    MPI_Comm comm);
+
+
+#define hgraph_validate zpart_hgraph_validate
+/**
+* @brief Check my chunk of the hypergraph for out-of-range pins, duplicate
+*        pins, and empty hyperedges, and report global counts. Pins are sorted
+*        within each hyperedge.
+*
+* @param hg My chunk of the hypergraph.
+* @param validate VALIDATE_CLEAN to remove problems, VALIDATE_STRICT to only
+*                 count them.
+* @param ndropped My pins which were already dropped while reading because
+*                 their hyperedge was out of range. Counted as out-of-range.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return The global number of problems found.
+*/
+long long hgraph_validate(
+    hgraph * const hg,
+    validate_mode validate,
+    long long ndropped,
+    MPI_Comm comm);
+
+
+#define hgraph_check zpart_hgraph_check
+/**
+* @brief Validate a freshly loaded hypergraph according to 'validate'.
+*
+* @param hg My chunk of the hypergraph.
+* @param fname The file the hypergraph was read from, for error messages.
+* @param validate How to handle input problems.
+* @param ndropped My pins which were dropped while reading because their
+*                 hyperedge was out of range.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return 'hg', or NULL (after freeing 'hg') if strict validation failed.
+*/
+hgraph * hgraph_check(
+    hgraph * const hg,
+    char const * const fname,
+    validate_mode validate,
+    long long ndropped,
     MPI_Comm comm);
 
 
@@ -81,6 +155,119 @@ hgraph * hgraph_alloc(
     int local_connections);
 
 
+#define hgraph_transpose zpart_hgraph_transpose
+/**
+* @brief Build the vertex-major transpose (vptr/vind) of a distributed
+*        hypergraph, storing each pin with the owner of its vertex, and switch
+*        the layout served to Zoltan to ZOLTAN_COMPRESSED_VERTEX.
+*
+* @param hg The hypergraph to transpose.
+* @param comm The communicator the hypergraph is distributed among.
+*/
+void hgraph_transpose(
+    hgraph * const hg,
+    MPI_Comm comm);
+
+
+#define hgraph_cut zpart_hgraph_cut
+/**
+* @brief Compute the hypergraph cut metrics of a partition.
+*
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'.
+* @param nparts The number of parts.
+* @param comm The communicator the hypergraph is distributed among.
+* @param cutnets [OUT] The number of hyperedges spanning more than one part.
+*
+* @return The (lambda-1) cut.
+*/
+long long hgraph_cut(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm,
+    long long * cutnets);
+
+
+#define hgraph_choose_layout zpart_hgraph_choose_layout
+/**
+* @brief Choose between the compressed-edge and compressed-vertex layouts. We
+*        prefer the vertex layout when there are at least LAYOUT_MIN_RATIO
+*        times more hyperedges than vertices, as long as vertex degrees are
+*        not skewed enough to leave some rank with too many pins.
+*
+* @param hg The distributed hypergraph.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return ZOLTAN_COMPRESSED_EDGE or ZOLTAN_COMPRESSED_VERTEX.
+*/
+int hgraph_choose_layout(
+    hgraph const * const hg,
+    MPI_Comm comm);
+
+
+#define hgraph_compress zpart_hgraph_compress
+/**
+* @brief Replace eind with a compressed representation. Pins are sorted within
+*        each hyperedge, and each hyperedge is stored as its first pin
+*        (varint), followed by a bit width and the remaining deltas packed at
+*        that width. Decoding is a branch-free shift-and-mask loop.
+*
+* @param hg The hypergraph to compress.
+*/
+void hgraph_compress(
+    hgraph * const hg);
+
+
+#define hgraph_decode zpart_hgraph_decode
+/**
+* @brief Decode the pins of one compressed hyperedge.
+*
+* @param hg The compressed hypergraph.
+* @param h The local hyperedge.
+* @param pins [OUT] The decoded pins, of length eptr[h+1] - eptr[h].
+*/
+void hgraph_decode(
+    hgraph const * const hg,
+    int h,
+    ZOLTAN_ID_TYPE * const pins);
+
+
+#define hgraph_scratch zpart_hgraph_scratch
+/**
+* @brief Allocate a buffer large enough to decode any local hyperedge.
+*
+* @param hg The hypergraph.
+*
+* @return The buffer. Must be freed!
+*/
+ZOLTAN_ID_TYPE * hgraph_scratch(
+    hgraph const * const hg);
+
+
+/**
+* @brief Access the pins of a local hyperedge, decoding them into 'scratch'
+*        if the hypergraph is compressed.
+*
+* @param hg The hypergraph.
+* @param h The local hyperedge.
+* @param scratch A buffer from hgraph_scratch().
+*
+* @return The pins of 'h'.
+*/
+static inline ZOLTAN_ID_TYPE const * hg_pins(
+    hgraph const * const hg,
+    int const h,
+    ZOLTAN_ID_TYPE * const scratch)
+{
+  if(hg->cind == NULL) {
+    return hg->eind + hg->eptr[h];
+  }
+  hgraph_decode(hg, h, scratch);
+  return scratch;
+}
+
+
 #define hgraph_free zpart_hgraph_free
 /**
 * @brief Free all memory allocated from hgraph_alloc().
@@ -1,13 +1,194 @@
 
+
 /******************************************************************************
  * INCLUDES
  *****************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
 #include <mpi.h>
 
 #include "graph.h"
 #include "part.h"
+#include "migrate.h"
+#include "map.h"
+#include "refine.h"
+#include "sparse.h"
+#include "cache.h"
+#include "stream.h"
+#include "reorder.h"
+#include "serve.h"
+#include "timer.h"
+
+
+/******************************************************************************
+ * COMMANDLINE OPTIONS
+ *****************************************************************************/
+/* options without a short form */
+enum
+{
+  OPT_REFINE_TIME = 256,
+  OPT_VALIDATE,
+  OPT_ZOLTAN_CHECK,
+  OPT_MODEL,
+  OPT_SEED,
+  OPT_CACHE,
+  OPT_CACHE_MAX,
+  OPT_PHG_STATS,
+  OPT_STREAM,
+  OPT_GRAPH,
+  OPT_CLIQUE_CAP,
+  OPT_REORDER,
+  OPT_SERVE,
+  OPT_SERVE_MAX,
+  OPT_DISTRIBUTE,
+};
+
+static struct option const long_opts[] = {
+  {"shards", required_argument, NULL, 's'},
+  {"map",    no_argument,       NULL, 'm'},
+  {"topo",   required_argument, NULL, 't'},
+  {"refine", required_argument, NULL, 'r'},
+  {"layout", required_argument, NULL, 'l'},
+  {"format", required_argument, NULL, 'f'},
+  {"compress", no_argument,     NULL, 'z'},
+  {"model", required_argument, NULL, OPT_MODEL},
+  {"validate", required_argument, NULL, OPT_VALIDATE},
+  {"zoltan-check", no_argument, NULL, OPT_ZOLTAN_CHECK},
+  {"refine-time", required_argument, NULL, OPT_REFINE_TIME},
+  {"param",  required_argument, NULL, 'p'},
+  {"seed",   required_argument, NULL, OPT_SEED},
+  {"cache",  required_argument, NULL, OPT_CACHE},
+  {"cache-max", required_argument, NULL, OPT_CACHE_MAX},
+  {"phg-stats", no_argument,   NULL, OPT_PHG_STATS},
+  {"stream", no_argument,      NULL, OPT_STREAM},
+  {"graph",  required_argument, NULL, OPT_GRAPH},
+  {"clique-cap", required_argument, NULL, OPT_CLIQUE_CAP},
+  {"reorder", required_argument, NULL, OPT_REORDER},
+  {"serve",  required_argument, NULL, OPT_SERVE},
+  {"serve-max", required_argument, NULL, OPT_SERVE_MAX},
+  {"distribute", required_argument, NULL, OPT_DISTRIBUTE},
+  {"help",   no_argument,       NULL, 'h'},
+  {NULL, 0, NULL, 0}
+};
+
+
+/**
+* @brief Print usage information.
+*
+* @param bin The name of the executable.
+*/
+static void __usage(
+    char const * const bin)
+{
+  printf("usage: %s [options] [hgraph] [nparts] [out]\n", bin);
+  printf("\n");
+  printf("options:\n");
+  printf("  -s, --shards=PREFIX  migrate the hypergraph to the owner of each\n");
+  printf("                       part and write shards to PREFIX.<part>.bin\n");
+  printf("  -m, --map            relabel parts to minimize inter-node volume\n");
+  printf("  -t, --topo=FILE      read the node of each rank from FILE, one per\n");
+  printf("                       line (implies --map)\n");
+  printf("  -r, --refine=ROUNDS  run up to ROUNDS rounds of parallel k-way\n");
+  printf("                       refinement after partitioning\n");
+  printf("  --refine-time=SECS   stop refinement after SECS seconds\n");
+  printf("  -l, --layout=LAYOUT  serve Zoltan 'edge'-major (default), 'vertex'-\n");
+  printf("                       major, or 'auto'-selected pin lists\n");
+  printf("  -f, --format=FMT     input is 'hmetis', 'mtx' (MatrixMarket), or\n");
+  printf("                       'patoh'. Default: guessed from the extension\n");
+  printf("  -z, --compress       store pins delta + bit-packed in memory\n");
+  printf("  --model=MODEL        hypergraph model of a matrix: 'column'-net\n");
+  printf("                       (default), 'row'-net, or 'fine'-grain\n");
+  printf("  --validate=MODE      'clean' (default) removes out-of-range pins,\n");
+  printf("                       duplicate pins, and empty hyperedges, 'strict'\n");
+  printf("                       fails on them, and 'off' skips validation\n");
+  printf("  --zoltan-check       also run Zoltan's CHECK_HYPERGRAPH\n");
+  printf("  -p, --param=KEY=VAL  set a Zoltan parameter (may be repeated)\n");
+  printf("  --seed=N             set Zoltan's random seed\n");
+  printf("  --cache=DIR          reuse partitions of identical runs from DIR\n");
+  printf("  --cache-max=MB       bound the cache size (default: 1024)\n");
+  printf("  --phg-stats          report PHG's per-phase times, per-level sizes,\n");
+  printf("                       and Zoltan_LB_Eval_HG() statistics\n");
+  printf("  --stream             partition while reading an hMetis file in one\n");
+  printf("                       low-memory pass instead of using Zoltan\n");
+  printf("  --graph=MODEL        partition the 'star' or 'clique' expansion with\n");
+  printf("                       Zoltan's graph partitioner instead of PHG\n");
+  printf("  --clique-cap=N       sample hyperedges with more than N pins in the\n");
+  printf("                       clique expansion (default: 16)\n");
+  printf("  --reorder=ROUNDS     redistribute vertices and hyperedges in a\n");
+  printf("                       locality-improving order before partitioning\n");
+  printf("  --distribute=MODE    own vertices in contiguous ID 'block's (default)\n");
+  printf("                       or on the rank holding most of their 'pins'\n");
+  printf("  --serve=SOCKET       keep hypergraphs loaded and serve requests on a\n");
+  printf("                       Unix socket instead of running once\n");
+  printf("  --serve-max=N        keep at most N hypergraphs loaded (default: 4)\n");
+  printf("  -h, --help           print this message\n");
+}
+
+
+/**
+* @brief Parse the integer argument of an option.
+*
+* @param opt The option, for error messages.
+* @param str The argument.
+* @param min The smallest allowed value.
+* @param max The largest allowed value.
+* @param rank My rank. Only rank 0 reports errors.
+* @param val [OUT] The parsed value.
+*
+* @return 1 if 'str' is an integer in [min, max].
+*/
+static int __parse_int(
+    char const * const opt,
+    char const * const str,
+    long long min,
+    long long max,
+    int rank,
+    long long * const val)
+{
+  char * endptr;
+  *val = strtoll(str, &endptr, 10);
+  if(endptr == str || *endptr != '\0' || *val < min || *val > max) {
+    if(rank == 0) {
+      fprintf(stderr, "ZPART: %s expects an integer >= %lld, got '%s'\n",
+          opt, min, str);
+    }
+    return 0;
+  }
+  return 1;
+}
+
+
+/**
+* @brief Parse the non-negative real argument of an option.
+*
+* @param opt The option, for error messages.
+* @param str The argument.
+* @param rank My rank. Only rank 0 reports errors.
+* @param val [OUT] The parsed value.
+*
+* @return 1 if 'str' is a non-negative number.
+*/
+static int __parse_seconds(
+    char const * const opt,
+    char const * const str,
+    int rank,
+    double * const val)
+{
+  char * endptr;
+  *val = strtod(str, &endptr);
+  if(endptr == str || *endptr != '\0' || !(*val >= 0.)) {
+    if(rank == 0) {
+      fprintf(stderr, "ZPART: %s expects a number >= 0, got '%s'\n", opt,
+          str);
+    }
+    return 0;
+  }
+  return 1;
+}
+
 
 
 /******************************************************************************
@@ -18,39 +199,550 @@ int main(
     char ** argv)
 {
   MPI_Init(&argc, &argv);
-  int rank;
+  int rank, npes;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &npes);
+
+  char const * shard_prefix = NULL;
+  char const * topo_fname = NULL;
+  int do_map = 0;
+  int refine_rounds = 0;
+  double refine_seconds = 0.;
+  char const * layout = "edge";
+  validate_mode validate = VALIDATE_CLEAN;
+  zparams params = {0, NULL, NULL};
+  char const * format = NULL;
+  hgraph_model model = MODEL_COLUMN_NET;
+  char const * cache_dir = NULL;
+  long long cache_max = 1024;
+  int do_compress = 0;
+  int phg_stats = 0;
+  int do_stream = 0;
+  expand_model graph_model = EXPAND_NONE;
+  int clique_cap = 16;
+  int reorder_rounds = 0;
+  char const * serve_path = NULL;
+  int serve_max = 4;
+  int owner_pins = 0;
 
-  if(argc < 4) {
+  long long num;
+  int c;
+  while((c = getopt_long(argc, argv, "s:mt:r:l:f:zp:h", long_opts, NULL)) != -1) {
+    switch(c) {
+    case 's':
+      shard_prefix = optarg;
+      break;
+    case 'm':
+      do_map = 1;
+      break;
+    case 't':
+      do_map = 1;
+      topo_fname = optarg;
+      break;
+    case 'r':
+      if(!__parse_int("--refine", optarg, 0, INT_MAX, rank, &num)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      refine_rounds = (int) num;
+      break;
+    case 'l':
+      layout = optarg;
+      break;
+    case OPT_REFINE_TIME:
+      if(!__parse_seconds("--refine-time", optarg, rank, &refine_seconds)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'f':
+      format = optarg;
+      break;
+    case 'z':
+      do_compress = 1;
+      break;
+    case OPT_MODEL:
+      if(strcmp(optarg, "column") == 0) {
+        model = MODEL_COLUMN_NET;
+      } else if(strcmp(optarg, "row") == 0) {
+        model = MODEL_ROW_NET;
+      } else if(strcmp(optarg, "fine") == 0) {
+        model = MODEL_FINE_GRAIN;
+      } else {
+        if(rank == 0) {
+          fprintf(stderr, "ZPART: unknown model '%s'\n", optarg);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_VALIDATE:
+      if(strcmp(optarg, "clean") == 0) {
+        validate = VALIDATE_CLEAN;
+      } else if(strcmp(optarg, "strict") == 0) {
+        validate = VALIDATE_STRICT;
+      } else if(strcmp(optarg, "off") == 0) {
+        validate = VALIDATE_OFF;
+      } else {
+        if(rank == 0) {
+          fprintf(stderr, "ZPART: unknown validation mode '%s'\n", optarg);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'p': {
+      char * const eq = strchr(optarg, '=');
+      if(eq == NULL) {
+        if(rank == 0) {
+          fprintf(stderr, "ZPART: expected KEY=VAL, got '%s'\n", optarg);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      *eq = '\0';
+      zparams_set(&params, optarg, eq + 1);
+      *eq = '=';
+      break;
+    }
+    case OPT_SEED:
+      zparams_set(&params, "SEED", optarg);
+      break;
+    case OPT_CACHE:
+      cache_dir = optarg;
+      break;
+    case OPT_CACHE_MAX:
+      if(!__parse_int("--cache-max", optarg, 1, LLONG_MAX >> 20, rank, &num)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      cache_max = num;
+      break;
+    case OPT_PHG_STATS:
+      phg_stats = 1;
+      break;
+    case OPT_STREAM:
+      do_stream = 1;
+      break;
+    case OPT_GRAPH:
+      if(strcmp(optarg, "star") == 0) {
+        graph_model = EXPAND_STAR;
+      } else if(strcmp(optarg, "clique") == 0) {
+        graph_model = EXPAND_CLIQUE;
+      } else {
+        if(rank == 0) {
+          fprintf(stderr, "ZPART: unknown graph model '%s'\n", optarg);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_CLIQUE_CAP:
+      if(!__parse_int("--clique-cap", optarg, 2, INT_MAX, rank, &num)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      clique_cap = (int) num;
+      break;
+    case OPT_REORDER:
+      if(!__parse_int("--reorder", optarg, 0, INT_MAX, rank, &num)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      reorder_rounds = (int) num;
+      break;
+    case OPT_SERVE:
+      serve_path = optarg;
+      break;
+    case OPT_SERVE_MAX:
+      if(!__parse_int("--serve-max", optarg, 1, INT_MAX, rank, &num)) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      serve_max = (int) num;
+      break;
+    case OPT_DISTRIBUTE:
+      if(strcmp(optarg, "block") == 0) {
+        owner_pins = 0;
+      } else if(strcmp(optarg, "pins") == 0) {
+        owner_pins = 1;
+      } else {
+        if(rank == 0) {
+          fprintf(stderr, "ZPART: unknown distribution '%s'\n", optarg);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+      }
+      break;
+    case OPT_ZOLTAN_CHECK:
+      zparams_set(&params, "CHECK_HYPERGRAPH", "1");
+      break;
+    case 'h':
+    default:
+      if(rank == 0) {
+        __usage(argv[0]);
+      }
+      MPI_Finalize();
+      return (c == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  /* PHG's statistics only exist when PHG does the partitioning */
+  if(phg_stats && graph_model != EXPAND_NONE) {
+    if(rank == 0) {
+      fprintf(stderr, "ZPART: --phg-stats cannot be combined with --graph\n");
+    }
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  /* stay up and answer requests instead of running once */
+  if(serve_path != NULL) {
+    if(do_stream || shard_prefix != NULL || cache_dir != NULL) {
+      if(rank == 0) {
+        fprintf(stderr, "ZPART: --serve does not support --stream, --shards, "
+            "or --cache\n");
+      }
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+    if(strcmp(layout, "edge") != 0 && strcmp(layout, "vertex") != 0 &&
+        strcmp(layout, "auto") != 0) {
+      if(rank == 0) {
+        fprintf(stderr, "ZPART: unknown layout '%s'\n", layout);
+      }
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+    if(format != NULL && strcmp(format, "hmetis") != 0 &&
+        strcmp(format, "mtx") != 0 && strcmp(format, "patoh") != 0) {
+      if(rank == 0) {
+        fprintf(stderr, "ZPART: unknown format '%s'\n", format);
+      }
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+
+    serve_opts opts;
+    opts.format = format;
+    opts.model = model;
+    opts.validate = validate;
+    opts.layout = layout;
+    opts.compress = do_compress;
+    opts.reorder_rounds = reorder_rounds;
+    opts.owner_pins = owner_pins;
+    opts.params = &params;
+    opts.phg_stats = phg_stats;
+    opts.graph_model = graph_model;
+    opts.clique_cap = clique_cap;
+    opts.refine_rounds = refine_rounds;
+    opts.refine_seconds = refine_seconds;
+    opts.do_map = do_map;
+    opts.topo_fname = topo_fname;
+    opts.max_resident = serve_max;
+
+    int const rc = serve(serve_path, &opts, MPI_COMM_WORLD);
+    zparams_free(&params);
+    MPI_Finalize();
+    return (rc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if(argc - optind < 3) {
     if(rank == 0) {
-      printf("usage: %s [hmetis graph] [nparts] [out]\n", argv[0]);
+      __usage(argv[0]);
     }
     MPI_Finalize();
     return EXIT_SUCCESS;
   }
+  char const * const gfname = argv[optind];
+  char const * const ofname = argv[optind+2];
+  if(!__parse_int("nparts", argv[optind+1], 1, INT_MAX, rank, &num)) {
+    zparams_free(&params);
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+  int const nparts = (int) num;
+
+  /* guess the input format from the extension */
+  if(format == NULL) {
+    char const * const ext = strrchr(gfname, '.');
+    if(ext != NULL && strcmp(ext, ".mtx") == 0) {
+      format = "mtx";
+    } else if(ext != NULL && strcmp(ext, ".patoh") == 0) {
+      format = "patoh";
+    } else {
+      format = "hmetis";
+    }
+  }
+
+  /* partition while reading, without ever holding the pins */
+  if(do_stream) {
+    if(strcmp(format, "hmetis") != 0 || shard_prefix != NULL || do_map ||
+        refine_rounds > 0 || cache_dir != NULL ||
+        graph_model != EXPAND_NONE || strcmp(layout, "edge") != 0 ||
+        do_compress || phg_stats || reorder_rounds > 0 || owner_pins) {
+      if(rank == 0) {
+        fprintf(stderr, "ZPART: --stream needs hMetis input and does not "
+            "support --shards, --map, --refine, --cache, --graph, --layout, "
+            "--compress, --phg-stats, --reorder, or --distribute=pins\n");
+      }
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t stream_time;
+    timer_fstart(&stream_time);
+    int * myparts = NULL;
+    hgraph * hg = stream_partition(gfname, nparts, MPI_COMM_WORLD, &myparts);
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&stream_time);
+    if(hg == NULL) {
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+    if(rank == 0) {
+      printf("Streaming time: %0.3fs\n", stream_time.seconds);
+    }
+
+    write_parts(MPI_COMM_WORLD, hg, myparts, ofname);
+
+    free(myparts);
+    hgraph_free(hg);
+    zparams_free(&params);
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+  }
 
   /* load and distribute graph */
-  char const * const gfname = argv[1];
-  hgraph * hg = distribute_hgraph(gfname, MPI_COMM_WORLD);
+  MPI_Barrier(MPI_COMM_WORLD);
+  zp_timer_t read_time;
+  timer_fstart(&read_time);
+  hgraph * hg = NULL;
+  if(strcmp(format, "hmetis") == 0) {
+    hg = distribute_hgraph(gfname, validate, MPI_COMM_WORLD);
+  } else if(strcmp(format, "mtx") == 0) {
+    hg = distribute_mtx(gfname, model, validate, MPI_COMM_WORLD);
+  } else if(strcmp(format, "patoh") == 0) {
+    hg = distribute_patoh(gfname, validate, MPI_COMM_WORLD);
+  } else if(rank == 0) {
+    fprintf(stderr, "ZPART: unknown format '%s'\n", format);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  timer_stop(&read_time);
+  if(rank == 0 && hg != NULL) {
+    printf("Read time: %0.3fs\n", read_time.seconds);
+  }
+  /* everything up to the layout is shared by both layouts */
+  double build_seconds = read_time.seconds;
   if(hg == NULL) {
     MPI_Finalize();
     return EXIT_FAILURE;
   }
 
-  char * endptr;
-  int const nparts = (int) strtol(argv[2], &endptr, 10);
-  if(endptr == argv[2]) {
-    printf("ZPART: integer expected for #partitions\n");
+  /* follow the hypergraph structure in ownership and local order */
+  if(reorder_rounds > 0) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t ro_time;
+    timer_fstart(&ro_time);
+    hgraph * reordered = reorder_hgraph(hg, reorder_rounds, MPI_COMM_WORLD);
+    hgraph_free(hg);
+    hg = reordered;
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&ro_time);
+    if(rank == 0) {
+      printf("Reorder time: %0.3fs\n", ro_time.seconds);
+    }
+    build_seconds += ro_time.seconds;
+  }
+
+  /* own each vertex where most of its pins are */
+  if(owner_pins) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t own_time;
+    timer_fstart(&own_time);
+    reorder_owners(hg, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&own_time);
+    if(rank == 0) {
+      printf("Vertex owner time: %0.3fs\n", own_time.seconds);
+    }
+    build_seconds += own_time.seconds;
+  }
+
+  /* choose which pin lists to hand to Zoltan */
+  int fmt;
+  if(strcmp(layout, "edge") == 0) {
+    fmt = ZOLTAN_COMPRESSED_EDGE;
+  } else if(strcmp(layout, "vertex") == 0) {
+    fmt = ZOLTAN_COMPRESSED_VERTEX;
+  } else if(strcmp(layout, "auto") == 0) {
+    fmt = hgraph_choose_layout(hg, MPI_COMM_WORLD);
+  } else {
+    if(rank == 0) {
+      fprintf(stderr, "ZPART: unknown layout '%s'\n", layout);
+    }
     MPI_Finalize();
     return EXIT_FAILURE;
   }
+  if(fmt == ZOLTAN_COMPRESSED_VERTEX) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t tr_time;
+    timer_fstart(&tr_time);
+    hgraph_transpose(hg, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&tr_time);
+    if(rank == 0) {
+      printf("Transpose time: %0.3fs\n", tr_time.seconds);
+      printf("Layout build time: edge %0.3fs, vertex %0.3fs (+%0.3fs)\n",
+          build_seconds, build_seconds + tr_time.seconds, tr_time.seconds);
+    }
+  } else if(rank == 0) {
+    printf("Layout build time: edge %0.3fs\n", build_seconds);
+  }
+  if(rank == 0) {
+    printf("Hypergraph layout: compressed-%s\n",
+        (fmt == ZOLTAN_COMPRESSED_VERTEX) ? "vertex" : "edge");
+  }
+
+  /* shrink the pin lists and report what a full decode costs */
+  if(do_compress) {
+    long long bytes[2];
+    bytes[0] = (long long) hg->nlocal_con * sizeof(ZOLTAN_ID_TYPE);
+    hgraph_compress(hg);
+    bytes[1] = (long long) (hg->cptr[hg->nlocal_h] +
+        (hg->nlocal_h+1) * sizeof(size_t));
+    MPI_Allreduce(MPI_IN_PLACE, bytes, 2, MPI_LONG_LONG, MPI_SUM,
+        MPI_COMM_WORLD);
+
+    long long npins = hg->nlocal_con;
+    MPI_Allreduce(MPI_IN_PLACE, &npins, 1, MPI_LONG_LONG, MPI_SUM,
+        MPI_COMM_WORLD);
+
+    zp_timer_t dec_time;
+    timer_fstart(&dec_time);
+    ZOLTAN_ID_TYPE * scratch = hgraph_scratch(hg);
+    /* keep the decode from being optimized away */
+    volatile ZOLTAN_ID_TYPE sink = 0;
+    for(int h=0; h < hg->nlocal_h; ++h) {
+      hgraph_decode(hg, h, scratch);
+      if(hg->eptr[h+1] > hg->eptr[h]) {
+        sink += scratch[hg->eptr[h+1] - hg->eptr[h] - 1];
+      }
+    }
+    free(scratch);
+    timer_stop(&dec_time);
+    double dec_seconds = dec_time.seconds;
+    MPI_Allreduce(MPI_IN_PLACE, &dec_seconds, 1, MPI_DOUBLE, MPI_MAX,
+        MPI_COMM_WORLD);
+
+    if(rank == 0) {
+      printf("Pin storage: %lld -> %lld bytes (%0.2fx)\n", bytes[0], bytes[1],
+          (double) bytes[0] / (double) (bytes[1] > 0 ? bytes[1] : 1));
+      printf("Pin decode time: %0.3fs (%0.1f Mpins/s)\n", dec_seconds,
+          (dec_seconds > 0.) ? npins / dec_seconds / 1e6 : 0.);
+    }
+  }
+
+  /* reuse the result of an identical run if we can */
+  int * myparts = NULL;
+  char key[CACHE_KEY_LEN];
+  if(cache_dir != NULL) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t cache_time;
+    timer_fstart(&cache_time);
+    /* the graph model and the distribution are not Zoltan parameters, but
+     * change the result */
+    zparams keyparams = {0, NULL, NULL};
+    for(int i=0; i < params.nparams; ++i) {
+      zparams_set(&keyparams, params.keys[i], params.vals[i]);
+    }
+    if(graph_model != EXPAND_NONE) {
+      char model_str[64];
+      snprintf(model_str, sizeof(model_str), "%s:%d",
+          (graph_model == EXPAND_STAR) ? "star" : "clique", clique_cap);
+      zparams_set(&keyparams, "ZPART_GRAPH_MODEL", model_str);
+    }
+    if(reorder_rounds > 0) {
+      char rounds_str[32];
+      snprintf(rounds_str, sizeof(rounds_str), "%d", reorder_rounds);
+      zparams_set(&keyparams, "ZPART_REORDER", rounds_str);
+    }
+    if(owner_pins) {
+      zparams_set(&keyparams, "ZPART_DISTRIBUTE", "pins");
+    }
+    cache_key(hg, nparts, &keyparams, MPI_COMM_WORLD, key);
+    zparams_free(&keyparams);
+    myparts = cache_load(cache_dir, key, hg, nparts, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&cache_time);
+    if(rank == 0) {
+      printf("Cache %s: %s\n", (myparts != NULL) ? "hit" : "miss", key);
+      printf("Cache lookup time: %0.3fs\n", cache_time.seconds);
+    }
+  }
+
+  if(myparts == NULL) {
+    if(graph_model != EXPAND_NONE) {
+      myparts = partition_graph(hg, MPI_COMM_WORLD, nparts, &params,
+          graph_model, clique_cap);
+    } else {
+      myparts = partition(hg, MPI_COMM_WORLD, nparts, &params, phg_stats);
+    }
+    if(myparts == NULL) {
+      hgraph_free(hg);
+      zparams_free(&params);
+      MPI_Finalize();
+      return EXIT_FAILURE;
+    }
+    if(cache_dir != NULL) {
+      cache_store(cache_dir, key, hg, myparts, nparts, cache_max << 20,
+          MPI_COMM_WORLD);
+    }
+  }
+
+  /* cheap quality improvement on top of Zoltan's result */
+  if(refine_rounds > 0) {
+    refine_parts(hg, myparts, nparts, refine_rounds, refine_seconds,
+        MPI_COMM_WORLD);
+  }
+
+  /* place heavily-communicating parts on the same node */
+  if(do_map) {
+    int * perm = map_parts(hg, myparts, nparts, topo_fname, MPI_COMM_WORLD);
+    for(int v=0; v < hg->nlocal_v; ++v) {
+      myparts[v] = perm[myparts[v]];
+    }
+    free(perm);
+  }
+
+  write_parts(MPI_COMM_WORLD, hg, myparts, ofname);
 
-  int * myparts = partition(hg, MPI_COMM_WORLD, nparts);
+  /* ship each part to its owner and write the shards */
+  if(shard_prefix != NULL) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    zp_timer_t mig_time;
+    timer_fstart(&mig_time);
+
+    int nshards;
+    hgraph ** shards = migrate_hgraph(hg, myparts, nparts, MPI_COMM_WORLD,
+        &nshards);
+    for(int s=0; s < nshards; ++s) {
+      write_shard(shards[s], rank + (s * npes), shard_prefix);
+      hgraph_free(shards[s]);
+    }
+    free(shards);
 
-  write_parts(MPI_COMM_WORLD, myparts, hg->nlocal_v, argv[3]);
+    MPI_Barrier(MPI_COMM_WORLD);
+    timer_stop(&mig_time);
+    if(rank == 0) {
+      printf("Migration time: %0.3fs\n", mig_time.seconds);
+    }
+  }
 
   free(myparts);
   hgraph_free(hg);
+  zparams_free(&params);
 
   MPI_Finalize();
   return EXIT_SUCCESS;
@@ -0,0 +1,390 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "map.h"
+#include "comm.h"
+#include "migrate.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+typedef long long wgt_t;
+#define WGT_MPI_TYPE MPI_LONG_LONG
+
+/* maximum number of swap passes during refinement */
+static int const MAX_SWAP_PASSES = 16;
+
+/* the most quotient graph entries reduced in one MPI call */
+static size_t const REDUCE_CHUNK = 1 << 26;
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Relabel node IDs to be contiguous and 0-indexed, in order of first
+*        appearance.
+*
+* @param nodes nodes[r] is the node of rank 'r'. Overwritten.
+* @param npes The number of ranks.
+*
+* @return The number of distinct nodes.
+*/
+static int __compress_nodes(
+    int * const nodes,
+    int npes)
+{
+  int * ids = (int *) malloc(npes * sizeof(int));
+  int nnodes = 0;
+  for(int r=0; r < npes; ++r) {
+    int n;
+    for(n=0; n < nnodes; ++n) {
+      if(ids[n] == nodes[r]) {
+        break;
+      }
+    }
+    if(n == nnodes) {
+      ids[nnodes++] = nodes[r];
+    }
+    nodes[r] = n;
+  }
+  free(ids);
+  return nnodes;
+}
+
+
+/**
+* @brief Determine the node of each rank.
+*
+* @param topo_fname The topology file to read, or NULL to detect nodes via
+*                   MPI_COMM_TYPE_SHARED.
+* @param comm The communicator.
+* @param nnodes [OUT] The number of nodes.
+*
+* @return nodes[r] is the node of rank 'r'. Must be freed!
+*/
+static int * __rank_nodes(
+    char const * const topo_fname,
+    MPI_Comm comm,
+    int * nnodes)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  int * nodes = (int *) malloc(npes * sizeof(int));
+
+  if(topo_fname != NULL) {
+    if(rank == 0) {
+      FILE * fin;
+      if((fin = fopen(topo_fname, "r")) == NULL) {
+        fprintf(stderr, "ZPART: failed to open '%s'\n", topo_fname);
+        MPI_Abort(comm, 1);
+      }
+      for(int r=0; r < npes; ++r) {
+        if(fscanf(fin, "%d", nodes + r) != 1) {
+          fprintf(stderr, "ZPART: '%s' must list a node for each of %d ranks\n",
+              topo_fname, npes);
+          MPI_Abort(comm, 1);
+        }
+      }
+      fclose(fin);
+    }
+    MPI_Bcast(nodes, npes, MPI_INT, 0, comm);
+  } else {
+    /* the lowest rank on each node names it */
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+        &node_comm);
+    int leader = rank;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm);
+    MPI_Comm_free(&node_comm);
+    MPI_Allgather(&leader, 1, MPI_INT, nodes, 1, MPI_INT, comm);
+  }
+
+  *nnodes = __compress_nodes(nodes, npes);
+  return nodes;
+}
+
+
+/**
+* @brief Build the dense part-quotient communication graph. w(p,q) counts the
+*        hyperedges with pins in both 'p' and 'q'.
+*
+* @param hg The distributed hypergraph.
+* @param parts The part of each local vertex.
+* @param nparts The number of parts.
+* @param comm The communicator.
+*
+* @return The nparts x nparts matrix of weights, replicated on all ranks.
+*         Must be freed!
+*/
+static wgt_t * __quotient_graph(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm)
+{
+  int * pinparts = comm_pin_lookup(hg, parts, comm);
+
+  size_t const nentries = (size_t) nparts * (size_t) nparts;
+  wgt_t * local = (wgt_t *) calloc(nentries, sizeof(wgt_t));
+  wgt_t * global = (wgt_t *) malloc(nentries * sizeof(wgt_t));
+
+  int * seen = (int *) malloc(nparts * sizeof(int));
+  int * plist = (int *) malloc(nparts * sizeof(int));
+  for(int p=0; p < nparts; ++p) {
+    seen[p] = -1;
+  }
+
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    /* gather the distinct parts of h */
+    int nconn = 0;
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      int const p = pinparts[n];
+      if(seen[p] != h) {
+        seen[p] = h;
+        plist[nconn++] = p;
+      }
+    }
+
+    for(int i=0; i < nconn; ++i) {
+      for(int j=0; j < nconn; ++j) {
+        if(i != j) {
+          ++local[(plist[i] * (size_t) nparts) + plist[j]];
+        }
+      }
+    }
+  }
+
+  free(seen);
+  free(plist);
+  free(pinparts);
+
+  /* nparts^2 overflows an MPI count once nparts > 46340 */
+  for(size_t off=0; off < nentries; off += REDUCE_CHUNK) {
+    size_t const count = (nentries - off < REDUCE_CHUNK) ?
+        nentries - off : REDUCE_CHUNK;
+    MPI_Allreduce(local + off, global + off, (int) count, WGT_MPI_TYPE,
+        MPI_SUM, comm);
+  }
+  free(local);
+
+  return global;
+}
+
+
+/**
+* @brief Compute the volume which crosses node boundaries.
+*
+* @param w The quotient graph.
+* @param nparts The number of parts.
+* @param pnode pnode[p] is the node which part 'p' is placed on.
+*
+* @return The inter-node volume.
+*/
+static wgt_t __internode_volume(
+    wgt_t const * const w,
+    int nparts,
+    int const * const pnode)
+{
+  wgt_t vol = 0;
+  for(int p=0; p < nparts; ++p) {
+    for(int q=p+1; q < nparts; ++q) {
+      if(pnode[p] != pnode[q]) {
+        vol += w[(p * (size_t) nparts) + q];
+      }
+    }
+  }
+  return vol;
+}
+
+
+/**
+* @brief Greedily grow parts into nodes and then improve with pairwise swaps.
+*
+* @param w The quotient graph.
+* @param nparts The number of parts.
+* @param nnodes The number of nodes.
+* @param cap cap[n] is the number of part slots on node 'n'.
+* @param pnode [OUT] pnode[p] is the node assigned to part 'p'.
+*/
+static void __assign_nodes(
+    wgt_t const * const w,
+    int nparts,
+    int nnodes,
+    int const * const cap,
+    int * const pnode)
+{
+  /* conn[p*nnodes + n] is the weight between 'p' and the parts on 'n' */
+  wgt_t * conn = (wgt_t *) calloc((size_t) nparts * nnodes, sizeof(wgt_t));
+  wgt_t * total = (wgt_t *) calloc(nparts, sizeof(wgt_t));
+  for(int p=0; p < nparts; ++p) {
+    pnode[p] = -1;
+    for(int q=0; q < nparts; ++q) {
+      total[p] += w[(p * (size_t) nparts) + q];
+    }
+  }
+
+  /* grow each node from its heaviest-connected unassigned part */
+  for(int n=0; n < nnodes; ++n) {
+    for(int fill=0; fill < cap[n]; ++fill) {
+      int best = -1;
+      for(int p=0; p < nparts; ++p) {
+        if(pnode[p] != -1) {
+          continue;
+        }
+        if(best == -1 || conn[(p*nnodes)+n] > conn[(best*nnodes)+n] ||
+            (conn[(p*nnodes)+n] == conn[(best*nnodes)+n] &&
+             total[p] > total[best])) {
+          best = p;
+        }
+      }
+      assert(best != -1);
+      pnode[best] = n;
+      for(int q=0; q < nparts; ++q) {
+        conn[(q*nnodes)+n] += w[(q * (size_t) nparts) + best];
+      }
+    }
+  }
+
+  /* pairwise swaps between nodes */
+  for(int pass=0; pass < MAX_SWAP_PASSES; ++pass) {
+    int nswaps = 0;
+    for(int p=0; p < nparts; ++p) {
+      int const a = pnode[p];
+      wgt_t best_gain = 0;
+      int best = -1;
+      for(int q=0; q < nparts; ++q) {
+        int const b = pnode[q];
+        if(a == b) {
+          continue;
+        }
+        wgt_t const gain = (conn[(p*nnodes)+b] - conn[(p*nnodes)+a]) +
+            (conn[(q*nnodes)+a] - conn[(q*nnodes)+b]) -
+            (2 * w[(p * (size_t) nparts) + q]);
+        if(gain > best_gain) {
+          best_gain = gain;
+          best = q;
+        }
+      }
+      if(best == -1) {
+        continue;
+      }
+
+      int const b = pnode[best];
+      for(int r=0; r < nparts; ++r) {
+        wgt_t const wp = w[(r * (size_t) nparts) + p];
+        wgt_t const wq = w[(r * (size_t) nparts) + best];
+        conn[(r*nnodes)+a] += wq - wp;
+        conn[(r*nnodes)+b] += wp - wq;
+      }
+      pnode[p] = b;
+      pnode[best] = a;
+      ++nswaps;
+    }
+    if(nswaps == 0) {
+      break;
+    }
+  }
+
+  free(conn);
+  free(total);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+int * map_parts(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    char const * const topo_fname,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  MPI_Barrier(comm);
+  zp_timer_t map_time;
+  timer_fstart(&map_time);
+
+  int nnodes;
+  int * nodes = __rank_nodes(topo_fname, comm, &nnodes);
+  wgt_t * w = __quotient_graph(hg, parts, nparts, comm);
+
+  int * perm = (int *) malloc(nparts * sizeof(int));
+  int * pnode = (int *) malloc(nparts * sizeof(int));
+  int * cap = (int *) calloc(nnodes, sizeof(int));
+  for(int p=0; p < nparts; ++p) {
+    pnode[p] = nodes[shard_owner(p, npes)];
+    ++cap[pnode[p]];
+  }
+  wgt_t const before = __internode_volume(w, nparts, pnode);
+
+  if(rank == 0) {
+    __assign_nodes(w, nparts, nnodes, cap, pnode);
+
+    /* hand out each node's slots, keeping parts in place when possible */
+    int * taken = (int *) calloc(nparts, sizeof(int));
+    for(int p=0; p < nparts; ++p) {
+      perm[p] = -1;
+      if(nodes[shard_owner(p, npes)] == pnode[p]) {
+        perm[p] = p;
+        taken[p] = 1;
+      }
+    }
+    int slot = 0;
+    for(int p=0; p < nparts; ++p) {
+      if(perm[p] != -1) {
+        continue;
+      }
+      for(slot=0; slot < nparts; ++slot) {
+        if(!taken[slot] && nodes[shard_owner(slot, npes)] == pnode[p]) {
+          break;
+        }
+      }
+      assert(slot < nparts);
+      perm[p] = slot;
+      taken[slot] = 1;
+    }
+    free(taken);
+  }
+  MPI_Bcast(perm, nparts, MPI_INT, 0, comm);
+
+  /* where each part is placed under its new label */
+  for(int p=0; p < nparts; ++p) {
+    pnode[p] = nodes[shard_owner(perm[p], npes)];
+  }
+  wgt_t const after = __internode_volume(w, nparts, pnode);
+
+  MPI_Barrier(comm);
+  timer_stop(&map_time);
+  if(rank == 0) {
+    printf("Part mapping: %d nodes, inter-node volume %lld -> %lld\n",
+        nnodes, before, after);
+    printf("Part mapping time: %0.3fs\n", map_time.seconds);
+  }
+
+  free(cap);
+  free(pnode);
+  free(w);
+  free(nodes);
+  return perm;
+}
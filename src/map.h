@@ -0,0 +1,45 @@
+#ifndef ZPART_MAP_H
+#define ZPART_MAP_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define map_parts zpart_map_parts
+/**
+* @brief Compute a topology-aware relabeling of the parts. Part 'p' is placed
+*        on rank p % npes (see shard_owner()), so relabeling parts moves them
+*        between ranks and nodes.
+*
+*        We build the part-quotient communication graph, in which w(p,q) is
+*        the number of hyperedges with pins in both 'p' and 'q', and look for
+*        a permutation which minimizes the volume crossing node boundaries.
+*        Parts are greedily grown into nodes and then improved with pairwise
+*        swaps. The quotient graph is stored densely, so this is meant for
+*        nparts on the order of the number of ranks.
+*
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'.
+* @param nparts The number of parts.
+* @param topo_fname A file listing the node ID of each rank, one per line. If
+*                   NULL, nodes are detected with MPI_COMM_TYPE_SHARED.
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return perm[p] is the new label of part 'p'. Must be freed!
+*/
+int * map_parts(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    char const * const topo_fname,
+    MPI_Comm comm);
+
+#endif
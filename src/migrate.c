@@ -0,0 +1,284 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "migrate.h"
+#include "comm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* "ZPSHARD1" */
+static uint64_t const SHARD_MAGIC = 0x5a50534841524431ULL;
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Lexicographic comparison of (part, vtx) pairs for qsort().
+*/
+static int __cmp_pair(
+    void const * a,
+    void const * b)
+{
+  idx_t const * const x = (idx_t const *) a;
+  idx_t const * const y = (idx_t const *) b;
+  for(int i=0; i < 2; ++i) {
+    if(x[i] != y[i]) {
+      return (x[i] < y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+* @brief Lexicographic comparison of (part, hedge, vtx) triplets for qsort().
+*/
+static int __cmp_triplet(
+    void const * a,
+    void const * b)
+{
+  idx_t const * const x = (idx_t const *) a;
+  idx_t const * const y = (idx_t const *) b;
+  for(int i=0; i < 3; ++i) {
+    if(x[i] != y[i]) {
+      return (x[i] < y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+* @brief Binary search for a global vertex ID in a sorted list.
+*
+* @param gids The sorted global IDs.
+* @param n The length of gids.
+* @param gid The ID to search for.
+*
+* @return The local index of 'gid', or -1 if not found.
+*/
+static int __find_gid(
+    idx_t const * const gids,
+    int n,
+    idx_t const gid)
+{
+  int lo = 0;
+  int hi = n;
+  while(lo < hi) {
+    int const mid = lo + ((hi - lo) / 2);
+    if(gids[mid] < gid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < n && gids[lo] == gid) ? lo : -1;
+}
+
+
+/**
+* @brief Build the shard of one part from sorted records.
+*
+* @param vrecs The (part, vtx) pairs of this part.
+* @param nv The number of pairs.
+* @param precs The (part, hedge, vtx) triplets of this part.
+* @param np The number of triplets.
+*
+* @return The shard.
+*/
+static hgraph * __build_shard(
+    idx_t const * const vrecs,
+    int nv,
+    idx_t const * const precs,
+    int np)
+{
+  /* count distinct hyperedges */
+  int nh = 0;
+  for(int n=0; n < np; ++n) {
+    if(n == 0 || precs[3*n + 1] != precs[3*(n-1) + 1]) {
+      ++nh;
+    }
+  }
+
+  hgraph * shard = hgraph_alloc(nv, nh, np);
+  for(int v=0; v < nv; ++v) {
+    shard->v_gids[v] = vrecs[2*v + 1];
+  }
+
+  int h = -1;
+  for(int n=0; n < np; ++n) {
+    if(n == 0 || precs[3*n + 1] != precs[3*(n-1) + 1]) {
+      ++h;
+      shard->h_gids[h] = precs[3*n + 1];
+      shard->eptr[h] = n;
+    }
+    int const lv = __find_gid(shard->v_gids, nv, precs[3*n + 2]);
+    assert(lv >= 0);
+    shard->eind[n] = (idx_t) lv;
+  }
+  shard->eptr[nh] = np;
+
+  return shard;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+hgraph ** migrate_hgraph(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm,
+    int * nshards)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+
+  /* send each vertex to the owner of its part */
+  int * dest = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    dest[v] = shard_owner(parts[v], npes);
+  }
+  int * perm = comm_bucket(dest, hg->nlocal_v, sendcounts, comm);
+  free(dest);
+  idx_t * vsend = (idx_t *) malloc((2*hg->nlocal_v+1) * sizeof(idx_t));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vsend[2*perm[v] + 0] = (idx_t) parts[v];
+    vsend[2*perm[v] + 1] = hg->v_gids[v];
+  }
+  free(perm);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nvrecv;
+  idx_t * vrecv = comm_exchange(vsend, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nvrecv, NULL, comm);
+  free(vsend);
+  nvrecv /= 2;
+
+  /* each pin follows its vertex */
+  int * pinparts = comm_pin_lookup(hg, parts, comm);
+  int const ncon = hg->nlocal_con;
+  dest = (int *) malloc((ncon+1) * sizeof(int));
+  for(int n=0; n < ncon; ++n) {
+    dest[n] = shard_owner(pinparts[n], npes);
+  }
+  perm = comm_bucket(dest, ncon, sendcounts, comm);
+  free(dest);
+  idx_t * psend = (idx_t *) malloc((3*ncon+1) * sizeof(idx_t));
+  idx_t * scratch = hgraph_scratch(hg);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      psend[3*perm[n] + 0] = (idx_t) pinparts[n];
+      psend[3*perm[n] + 1] = hg->h_gids[h];
+      psend[3*perm[n] + 2] = pins[n - hg->eptr[h]];
+    }
+  }
+  free(scratch);
+  free(perm);
+  free(pinparts);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 3;
+  }
+  int nprecv;
+  idx_t * precv = comm_exchange(psend, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nprecv, NULL, comm);
+  free(psend);
+  free(sendcounts);
+  nprecv /= 3;
+
+  /* group everything by part */
+  qsort(vrecv, nvrecv, 2 * sizeof(idx_t), __cmp_pair);
+  qsort(precv, nprecv, 3 * sizeof(idx_t), __cmp_triplet);
+
+  int const nmine = (rank < nparts) ? ((nparts - rank - 1) / npes) + 1 : 0;
+  hgraph ** shards = (hgraph **) malloc((nmine+1) * sizeof(*shards));
+
+  int vstart = 0;
+  int pstart = 0;
+  for(int s=0; s < nmine; ++s) {
+    idx_t const part = (idx_t) (rank + (s * npes));
+
+    int vend = vstart;
+    while(vend < nvrecv && vrecv[2*vend] == part) {
+      ++vend;
+    }
+    int pend = pstart;
+    while(pend < nprecv && precv[3*pend] == part) {
+      ++pend;
+    }
+
+    shards[s] = __build_shard(vrecv + (2*vstart), vend - vstart,
+        precv + (3*pstart), pend - pstart);
+    shards[s]->nglobal_v = hg->nglobal_v;
+    shards[s]->nglobal_h = hg->nglobal_h;
+
+    vstart = vend;
+    pstart = pend;
+  }
+  assert(vstart == nvrecv);
+  assert(pstart == nprecv);
+
+  free(vrecv);
+  free(precv);
+
+  *nshards = nmine;
+  return shards;
+}
+
+
+void write_shard(
+    hgraph const * const shard,
+    int part,
+    char const * const prefix)
+{
+  char * fname = NULL;
+  asprintf(&fname, "%s.%d.bin", prefix, part);
+
+  FILE * fout;
+  if((fout = fopen(fname, "wb")) == NULL) {
+    fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
+    MPI_Finalize();
+    exit(1);
+  }
+
+  uint64_t header[8];
+  header[0] = SHARD_MAGIC;
+  header[1] = (uint64_t) part;
+  header[2] = (uint64_t) shard->nglobal_v;
+  header[3] = (uint64_t) shard->nglobal_h;
+  header[4] = (uint64_t) shard->nlocal_v;
+  header[5] = (uint64_t) shard->nlocal_h;
+  header[6] = (uint64_t) shard->nlocal_con;
+  header[7] = (uint64_t) sizeof(idx_t);
+
+  fwrite(header, sizeof(header[0]), 8, fout);
+  fwrite(shard->v_gids, sizeof(idx_t), shard->nlocal_v, fout);
+  fwrite(shard->h_gids, sizeof(idx_t), shard->nlocal_h, fout);
+  fwrite(shard->eptr, sizeof(int), shard->nlocal_h+1, fout);
+  fwrite(shard->eind, sizeof(idx_t), shard->nlocal_con, fout);
+
+  fclose(fout);
+  free(fname);
+}
@@ -0,0 +1,80 @@
+#ifndef ZPART_MIGRATE_H
+#define ZPART_MIGRATE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define shard_owner zpart_shard_owner
+/**
+* @brief Return the rank which owns the shard of part 'part'. Parts are dealt
+*        out cyclically, so part p lives on rank p % npes.
+*
+* @param part The part ID.
+* @param npes The number of ranks.
+*
+* @return The owning rank.
+*/
+static inline int shard_owner(
+    int const part,
+    int const npes)
+{
+  return part % npes;
+}
+
+
+#define migrate_hgraph zpart_migrate_hgraph
+/**
+* @brief Migrate a partitioned hypergraph such that each part is stored on
+*        its owning rank (see shard_owner()). Each vertex moves to its part,
+*        and each pin (h, v) moves along with vertex 'v'. Thus, a shard holds
+*        every hyperedge which touches the part, restricted to the pins
+*        inside the part.
+*
+*        Shards use local numbering: v_gids and h_gids map local IDs to
+*        global IDs, and eind stores local vertex IDs.
+*
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'.
+* @param nparts The number of parts.
+* @param comm The communicator the hypergraph is distributed among.
+* @param nshards [OUT] The number of shards returned.
+*
+* @return An array of shards, where shard 's' stores part rank + s*npes. Each
+*         shard must be freed with hgraph_free(), and the array with free().
+*/
+hgraph ** migrate_hgraph(
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm,
+    int * nshards);
+
+
+#define write_shard zpart_write_shard
+/**
+* @brief Write a shard to the binary file '<prefix>.<part>.bin'. The format is
+*        a header of eight 64-bit integers:
+*          magic, part, nglobal_v, nglobal_h, nlocal_v, nlocal_h, nlocal_con,
+*          sizeof(ZOLTAN_ID_TYPE)
+*        followed by v_gids[nlocal_v], h_gids[nlocal_h], eptr[nlocal_h+1] (as
+*        int), and eind[nlocal_con].
+*
+* @param shard The shard to write.
+* @param part The part ID of the shard.
+* @param prefix The output file prefix.
+*/
+void write_shard(
+    hgraph const * const shard,
+    int part,
+    char const * const prefix);
+
+#endif
@@ -4,11 +4,14 @@
  * INCLUDES
  *****************************************************************************/
 #include "graph.h"
+#include "part.h"
 #include "timer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <unistd.h>
 #include <mpi.h>
 
 
@@ -20,6 +23,18 @@
 
 static int const DEF_TAG = 0;
 
+/* the line length we expect from PHG's output */
+#define PHG_LINE_LEN 1024
+
+/**
+* @brief The parts of local vertices, for Zoltan_LB_Eval_HG().
+*/
+typedef struct
+{
+  hgraph const * hg;
+  int const * parts;
+} eval_data;
+
 
 /******************************************************************************
  * STATIC FUNCTIONS
@@ -28,8 +43,8 @@ static int const DEF_TAG = 0;
 
 static struct Zoltan_Struct * __init_zoltan(
     MPI_Comm comm,
-    hgraph * hg,
-    int nparts)
+    int nparts,
+    zparams const * const params)
 {
   /* initialize Zoltan */
   float ver;
@@ -40,51 +55,265 @@ static struct Zoltan_Struct * __init_zoltan(
     exit(1);
   }
 
-  struct Zoltan_Struct * zz = Zoltan_Create(MPI_COMM_WORLD);
+  struct Zoltan_Struct * zz = Zoltan_Create(comm);
+
+  /* defaults plus user overrides */
+  zparams eff = {0, NULL, NULL};
+  zparams_effective(&eff, nparts, params);
+  for(int i=0; i < eff.nparams; ++i) {
+    Zoltan_Set_Param(zz, eff.keys[i], eff.vals[i]);
+  }
+  zparams_free(&eff);
+
+  return zz;
+}
+
+
+/**
+* @brief Zoltan query function: the part of each local vertex.
+*/
+static void __get_parts(
+    void * data,
+    int gid_size,
+    int lid_size,
+    int nvtxs,
+    ZOLTAN_ID_PTR gids,
+    ZOLTAN_ID_PTR lids,
+    int * parts,
+    int * ierr)
+{
+  eval_data const * const ed = (eval_data *) data;
+  *ierr = ZOLTAN_OK;
+
+  assert(lid_size == 1);
+  for(int v=0; v < nvtxs; ++v) {
+    if(lids[v] >= (ZOLTAN_ID_TYPE) ed->hg->nlocal_v) {
+      *ierr = ZOLTAN_FATAL;
+      return;
+    }
+    parts[v] = ed->parts[lids[v]];
+  }
+}
+
+
+/**
+* @brief Point stdout at a temporary file so PHG's output can be parsed.
+*
+* @param saved [OUT] A duplicate of the original stdout.
+*
+* @return The temporary file, or NULL if stdout was not redirected.
+*/
+static FILE * __capture_begin(
+    int * const saved)
+{
+  FILE * tmp = tmpfile();
+  if(tmp == NULL) {
+    return NULL;
+  }
+  fflush(stdout);
+  *saved = dup(STDOUT_FILENO);
+  dup2(fileno(tmp), STDOUT_FILENO);
+  return tmp;
+}
+
+
+/**
+* @brief Restore stdout and rewind the captured output.
+*/
+static void __capture_end(
+    FILE * const tmp,
+    int saved)
+{
+  if(tmp == NULL) {
+    return;
+  }
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  rewind(tmp);
+}
+
+
+/**
+* @brief Pass captured output on to stdout unchanged.
+*/
+static void __capture_dump(
+    FILE * const tmp)
+{
+  if(tmp == NULL) {
+    return;
+  }
+  char line[PHG_LINE_LEN];
+  while(fgets(line, PHG_LINE_LEN, tmp) != NULL) {
+    fputs(line, stdout);
+  }
+  fflush(stdout);
+}
+
+
+/**
+* @brief Report the phases and levels found in PHG's output. Timer lines look
+*        like "  0 ZOLTAN_TIMER   1   Matching:  MyTime ... MaxTime ..." and
+*        level lines like "<0/0>: START   2 |V|=  ... |E|= ... #pins= ...".
+*        Level sizes are those of this rank's block of PHG's 2D distribution,
+*        not of the whole hypergraph.
+*
+* @param tmp The captured output.
+* @param npes The number of ranks PHG ran on.
+*/
+static void __report_phg(
+    FILE * const tmp,
+    int npes)
+{
+  char line[PHG_LINE_LEN];
+  while(fgets(line, PHG_LINE_LEN, tmp) != NULL) {
+    char * ptr;
+
+    if((ptr = strstr(line, "ZOLTAN_TIMER")) != NULL) {
+      char * colon = strchr(ptr, ':');
+      if(colon == NULL) {
+        continue;
+      }
+      *colon = '\0';
+
+      /* skip the timer index and padding to get the name */
+      ptr += strlen("ZOLTAN_TIMER");
+      strtol(ptr, &ptr, 10);
+      while(*ptr == ' ') {
+        ++ptr;
+      }
+
+      /* prefer the time across ranks */
+      char * val = strstr(colon + 1, "MaxTime");
+      if(val == NULL) {
+        val = strstr(colon + 1, "MyTime");
+      }
+      if(val == NULL) {
+        continue;
+      }
+      val += strcspn(val, " ");
+      printf("PHG phase: %s %0.3fs\n", ptr, strtod(val, NULL));
+      continue;
+    }
+
+    if((ptr = strstr(line, "START")) != NULL) {
+      int level;
+      long long nv, nh, npins;
+      if(sscanf(ptr, "START %d |V|=%lld |E|=%lld #pins=%lld", &level, &nv, &nh,
+            &npins) == 4) {
+        printf("PHG level %d: %lld vertices, %lld hyperedges, %lld pins "
+            "(rank 0's block, %d ranks)\n", level, nv, nh, npins, npes);
+      }
+    }
+  }
+}
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+void zparams_set(
+    zparams * const params,
+    char const * const key,
+    char const * const val)
+{
+  for(int i=0; i < params->nparams; ++i) {
+    if(strcasecmp(params->keys[i], key) == 0) {
+      free(params->vals[i]);
+      params->vals[i] = strdup(val);
+      return;
+    }
+  }
+
+  int const n = params->nparams++;
+  params->keys = (char **) realloc(params->keys, (n+1) * sizeof(char *));
+  params->vals = (char **) realloc(params->vals, (n+1) * sizeof(char *));
+  params->keys[n] = strdup(key);
+  params->vals[n] = strdup(val);
+}
+
 
+void zparams_effective(
+    zparams * const out,
+    int nparts,
+    zparams const * const overrides)
+{
   /* General parameters */
 
-  Zoltan_Set_Param(zz, "DEBUG_LEVEL", "0");
-  Zoltan_Set_Param(zz, "PHG_OUTPUT_LEVEL", "0");
-  Zoltan_Set_Param(zz, "FINAL_OUTPUT", "1");
-  Zoltan_Set_Param(zz, "LB_METHOD", "HYPERGRAPH");
-  Zoltan_Set_Param(zz, "LB_APPROACH", "PARTITION");
-  Zoltan_Set_Param(zz, "HYPERGRAPH_PACKAGE", "PHG");
-  Zoltan_Set_Param(zz, "NUM_GID_ENTRIES", "1");
-  Zoltan_Set_Param(zz, "NUM_LID_ENTRIES", "1");
-  Zoltan_Set_Param(zz, "RETURN_LISTS", "PARTS");
-  Zoltan_Set_Param(zz, "CHECK_HYPERGRAPH", "1");
+  zparams_set(out, "DEBUG_LEVEL", "0");
+  zparams_set(out, "PHG_OUTPUT_LEVEL", "0");
+  zparams_set(out, "FINAL_OUTPUT", "1");
+  zparams_set(out, "LB_METHOD", "HYPERGRAPH");
+  zparams_set(out, "LB_APPROACH", "PARTITION");
+  zparams_set(out, "HYPERGRAPH_PACKAGE", "PHG");
+  zparams_set(out, "NUM_GID_ENTRIES", "1");
+  zparams_set(out, "NUM_LID_ENTRIES", "1");
+  zparams_set(out, "RETURN_LISTS", "PARTS");
+  /* we validate the input ourselves while distributing it */
+  zparams_set(out, "CHECK_HYPERGRAPH", "0");
 
   /* default weights */
-  Zoltan_Set_Param(zz, "OBJ_WEIGHT_DIM", "0");
-  Zoltan_Set_Param(zz, "EDGE_WEIGHT_DIM", "0");
+  zparams_set(out, "OBJ_WEIGHT_DIM", "0");
+  zparams_set(out, "EDGE_WEIGHT_DIM", "0");
 
   /* set number of partitions */
   char * np = NULL;
   asprintf(&np, "%d", nparts);
-  Zoltan_Set_Param(zz, "NUM_GLOBAL_PARTS", np);
+  zparams_set(out, "NUM_GLOBAL_PARTS", np);
   free(np);
 
-  /* Application defined query functions */
-  Zoltan_Set_Num_Obj_Fn(zz, hg_get_nvtx, hg);
-  Zoltan_Set_Obj_List_Fn(zz, hg_get_vlist, hg);
-  Zoltan_Set_HG_Size_CS_Fn(zz, hg_get_netsizes, hg);
-  Zoltan_Set_HG_CS_Fn(zz, hg_get_hlist, hg);
+  /* user overrides */
+  if(overrides != NULL) {
+    for(int i=0; i < overrides->nparams; ++i) {
+      zparams_set(out, overrides->keys[i], overrides->vals[i]);
+    }
+  }
+}
 
-  return zz;
+
+void zparams_free(
+    zparams * const params)
+{
+  for(int i=0; i < params->nparams; ++i) {
+    free(params->keys[i]);
+    free(params->vals[i]);
+  }
+  free(params->keys);
+  free(params->vals);
+  params->nparams = 0;
+  params->keys = NULL;
+  params->vals = NULL;
 }
 
 
-/******************************************************************************
- * PUBLIC FUNCTIONS
- *****************************************************************************/
 int * partition(
     hgraph * hg,
     MPI_Comm comm,
-    int nparts)
+    int nparts,
+    zparams const * const params,
+    int phg_stats)
 {
+  /* ask PHG to report its phases and levels, unless the user chose levels */
+  zparams requested = {0, NULL, NULL};
+  if(phg_stats) {
+    zparams_set(&requested, "PHG_OUTPUT_LEVEL", "1");
+    zparams_set(&requested, "USE_TIMERS", "1");
+  }
+  if(params != NULL) {
+    for(int i=0; i < params->nparams; ++i) {
+      zparams_set(&requested, params->keys[i], params->vals[i]);
+    }
+  }
+
   /* initialize zoltan and set parameters */
-  struct Zoltan_Struct * zz = __init_zoltan(comm, hg, nparts);
+  struct Zoltan_Struct * zz = __init_zoltan(comm, nparts, &requested);
+  zparams_free(&requested);
+
+  /* Application defined query functions */
+  Zoltan_Set_Num_Obj_Fn(zz, hg_get_nvtx, hg);
+  Zoltan_Set_Obj_List_Fn(zz, hg_get_vlist, hg);
+  Zoltan_Set_HG_Size_CS_Fn(zz, hg_get_netsizes, hg);
+  Zoltan_Set_HG_CS_Fn(zz, hg_get_hlist, hg);
 
   int rank;
   MPI_Comm_rank(comm, &rank);
@@ -98,6 +327,12 @@ int * partition(
   int * import_ranks, * import_part;
   int * export_ranks, * export_part;
 
+  int saved = -1;
+  FILE * captured = NULL;
+  if(phg_stats) {
+    captured = __capture_begin(&saved);
+  }
+
   MPI_Barrier(comm);
   zp_timer_t part_time;
   timer_fstart(&part_time);
@@ -108,11 +343,16 @@ int * partition(
         &gid_size, &lid_size,
         &nimport, &import_gids, &import_lids, &import_ranks, &import_part,
         &nexport, &export_gids, &export_lids, &export_ranks, &export_part);
+  __capture_end(captured, saved);
   if (rc != ZOLTAN_OK){
+    /* keep whatever PHG reported before it failed */
+    __capture_dump(captured);
+    if(captured != NULL) {
+      fclose(captured);
+    }
     fprintf(stderr, "ZPART: Zoltan_LB_Partition() returned %d\n", rc);
-    MPI_Finalize();
     Zoltan_Destroy(&zz);
-    exit(1);
+    return NULL;
   }
 
   MPI_Barrier(comm);
@@ -127,6 +367,36 @@ int * partition(
     parts[export_lids[v]] = export_part[v];
   }
 
+  if(phg_stats) {
+    /* rank 0 holds the timers, but only sees its own block of each level */
+    if(rank == 0 && captured != NULL) {
+      int npes;
+      MPI_Comm_size(comm, &npes);
+      __report_phg(captured, npes);
+    }
+    if(captured != NULL) {
+      fclose(captured);
+    }
+
+    /* evaluate the parts we computed rather than the initial distribution */
+    eval_data ed;
+    ed.hg = hg;
+    ed.parts = parts;
+    Zoltan_Set_Part_Multi_Fn(zz, __get_parts, &ed);
+
+    ZOLTAN_HG_EVAL eval;
+    rc = Zoltan_LB_Eval_HG(zz, 0, &eval);
+    if(rc == ZOLTAN_OK && rank == 0) {
+      printf("PHG eval: (lambda-1) cut %0.0f, cut hyperedges %0.0f, "
+          "imbalance %0.3f, part sizes %0.0f-%0.0f\n",
+          eval.cutl[EVAL_GLOBAL_SUM], eval.cutn[EVAL_GLOBAL_SUM],
+          eval.imbalance, eval.nobj[EVAL_GLOBAL_MIN],
+          eval.nobj[EVAL_GLOBAL_MAX]);
+    } else if(rc != ZOLTAN_OK && rank == 0) {
+      fprintf(stderr, "ZPART: Zoltan_LB_Eval_HG() returned %d\n", rc);
+    }
+  }
+
   /* cleanup */
   Zoltan_LB_Free_Part(&import_gids, &import_lids, &import_ranks, &import_part);
   Zoltan_LB_Free_Part(&export_gids, &export_lids, &export_ranks, &export_part);
@@ -136,16 +406,117 @@ int * partition(
 }
 
 
+int * partition_graph(
+    hgraph * hg,
+    MPI_Comm comm,
+    int nparts,
+    zparams const * const params,
+    expand_model model,
+    int cap)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  MPI_Barrier(comm);
+  zp_timer_t exp_time;
+  timer_fstart(&exp_time);
+  egraph * eg = expand_hgraph(hg, model, cap, comm);
+  long long nedges = eg->xadj[eg->nlocal];
+  MPI_Allreduce(MPI_IN_PLACE, &nedges, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  MPI_Barrier(comm);
+  timer_stop(&exp_time);
+  if(rank == 0) {
+    printf("Graph expansion: %s, %lld edges\n",
+        (model == EXPAND_STAR) ? "star" : "clique", nedges / 2);
+    printf("Graph expansion time: %0.3fs\n", exp_time.seconds);
+  }
+
+  /* weights are needed for star vertices and clique edges */
+  zparams requested = {0, NULL, NULL};
+  zparams_set(&requested, "LB_METHOD", "GRAPH");
+  zparams_set(&requested, "OBJ_WEIGHT_DIM", "1");
+  zparams_set(&requested, "EDGE_WEIGHT_DIM", "1");
+  if(params != NULL) {
+    for(int i=0; i < params->nparams; ++i) {
+      zparams_set(&requested, params->keys[i], params->vals[i]);
+    }
+  }
+  struct Zoltan_Struct * zz = __init_zoltan(comm, nparts, &requested);
+  zparams_free(&requested);
+
+  Zoltan_Set_Num_Obj_Fn(zz, eg_get_nobj, eg);
+  Zoltan_Set_Obj_List_Fn(zz, eg_get_olist, eg);
+  Zoltan_Set_Num_Edges_Multi_Fn(zz, eg_get_nedges, eg);
+  Zoltan_Set_Edge_List_Multi_Fn(zz, eg_get_elist, eg);
+
+  /* zoltan output vars */
+  int changes;
+  int gid_size, lid_size;
+  int nimport, nexport;
+  ZOLTAN_ID_PTR import_gids, import_lids;
+  ZOLTAN_ID_PTR export_gids, export_lids;
+  int * import_ranks, * import_part;
+  int * export_ranks, * export_part;
+
+  MPI_Barrier(comm);
+  zp_timer_t part_time;
+  timer_fstart(&part_time);
+
+  int rc = Zoltan_LB_Partition(zz,
+        &changes,
+        &gid_size, &lid_size,
+        &nimport, &import_gids, &import_lids, &import_ranks, &import_part,
+        &nexport, &export_gids, &export_lids, &export_ranks, &export_part);
+  if (rc != ZOLTAN_OK){
+    fprintf(stderr, "ZPART: Zoltan_LB_Partition() returned %d\n", rc);
+    Zoltan_Destroy(&zz);
+    egraph_free(eg);
+    return NULL;
+  }
+
+  MPI_Barrier(comm);
+  timer_stop(&part_time);
+  if(rank == 0) {
+    printf("Zoltan/graph partitioning time: %0.3fs\n", part_time.seconds);
+  }
+
+  /* keep hypergraph vertices, dropping star vertices */
+  int * parts = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int i=0; i < nexport; ++i) {
+    if(export_lids[i] < (ZOLTAN_ID_TYPE) hg->nlocal_v) {
+      parts[export_lids[i]] = export_part[i];
+    }
+  }
+
+  Zoltan_LB_Free_Part(&import_gids, &import_lids, &import_ranks, &import_part);
+  Zoltan_LB_Free_Part(&export_gids, &export_lids, &export_ranks, &export_part);
+  Zoltan_Destroy(&zz);
+  egraph_free(eg);
+
+  /* judge the result by what we actually care about */
+  long long cutnets;
+  long long const cut = hgraph_cut(hg, parts, nparts, comm, &cutnets);
+  if(rank == 0) {
+    printf("Graph model: (lambda-1) cut %lld, cut hyperedges %lld\n", cut,
+        cutnets);
+  }
+
+  return parts;
+}
+
+
 void write_parts(
     MPI_Comm comm,
+    hgraph const * const hg,
     int const * const parts,
-    int nvtxs,
     char const * const fname)
 {
   int rank, npes;
   MPI_Comm_rank(comm, &rank);
   MPI_Comm_size(comm, &npes);
 
+  int const nvtxs = hg->nlocal_v;
+
   FILE * fout;
   if(rank == 0) {
     if((fout = fopen(fname, "w")) == NULL) {
@@ -157,32 +528,46 @@ void write_parts(
 
 
   if(rank == 0) {
+    /* vertices may be owned in any order, so place them by global ID */
+    int * all_parts = (int *) malloc((hg->nglobal_v+1) * sizeof(int));
+    for(idx_t v=0; v < hg->nglobal_v; ++v) {
+      all_parts[v] = -1;
+    }
+    for(int v=0; v < nvtxs; ++v) {
+      all_parts[hg->v_gids[v]] = parts[v];
+    }
+
     int * part_buf = NULL;
-    int buf_size = 0;
+    idx_t * gid_buf = NULL;
     MPI_Status status;
     /* receive from each rank */
     for(int p=1; p < npes; ++p) {
       /* receive partition info */
       int newsize;
       MPI_Recv(&newsize, 1, MPI_INT, p, DEF_TAG, comm, &status);
-      part_buf = realloc(part_buf, newsize * sizeof(int));
+      part_buf = realloc(part_buf, (newsize+1) * sizeof(int));
+      gid_buf = realloc(gid_buf, (newsize+1) * sizeof(idx_t));
+      MPI_Recv(gid_buf, newsize, ZOLTAN_ID_MPI_TYPE, p, DEF_TAG, comm,
+          &status);
       MPI_Recv(part_buf, newsize, MPI_INT, p, DEF_TAG, comm, &status);
 
-      /* now write to file */
       for(int v=0; v < newsize; ++v) {
-        fprintf(fout, "%d\n", part_buf[v]);
+        all_parts[gid_buf[v]] = part_buf[v];
       }
     }
     free(part_buf);
+    free(gid_buf);
 
-    /* now write own vertices */
-    for(int v=0; v < nvtxs; ++v) {
-      fprintf(fout, "%d\n", parts[v]);
+    /* now write to file */
+    for(idx_t v=0; v < hg->nglobal_v; ++v) {
+      fprintf(fout, "%d\n", all_parts[v]);
     }
+    free(all_parts);
 
   } else {
     /* just send part info */
     MPI_Send(&nvtxs, 1, MPI_INT, 0, DEF_TAG, comm);
+    MPI_Send(hg->v_gids, nvtxs, ZOLTAN_ID_MPI_TYPE, 0, DEF_TAG, comm);
     MPI_Send(parts, nvtxs, MPI_INT, 0, DEF_TAG, comm);
   }
 
@@ -192,4 +577,3 @@ void write_parts(
 }
 
 
-
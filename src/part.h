@@ -7,21 +7,128 @@
 
 #include <zoltan.h>
 #include "graph.h"
+#include "expand.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+#define zparams zpart_zparams
+/**
+* @brief A list of Zoltan parameters which override zpart's defaults.
+*/
+typedef struct
+{
+  int nparams;
+  char ** keys;
+  char ** vals;
+} zparams;
 
 
 /******************************************************************************
  * FUNCTIONS
  *****************************************************************************/
 
+#define zparams_set zpart_zparams_set
+/**
+* @brief Set a Zoltan parameter, replacing any previous value of 'key'.
+*
+* @param params The parameter list. Must be zero-initialized before first use.
+* @param key The parameter name.
+* @param val The parameter value.
+*/
+void zparams_set(
+    zparams * const params,
+    char const * const key,
+    char const * const val);
+
+
+#define zparams_effective zpart_zparams_effective
+/**
+* @brief Build the full list of parameters handed to Zoltan: zpart's defaults
+*        followed by any overrides.
+*
+* @param out The parameter list to fill. Must be zero-initialized.
+* @param nparts The number of parts.
+* @param overrides Zoltan parameters which override the defaults. May be NULL.
+*/
+void zparams_effective(
+    zparams * const out,
+    int nparts,
+    zparams const * const overrides);
+
+
+#define zparams_free zpart_zparams_free
+/**
+* @brief Free all memory allocated by zparams_set().
+*
+* @param params The parameter list.
+*/
+void zparams_free(
+    zparams * const params);
+
+
+/**
+* @brief Partition a distributed hypergraph with Zoltan/PHG.
+*
+* @param hg The distributed hypergraph.
+* @param comm The communicator the hypergraph is distributed among.
+* @param nparts The number of parts.
+* @param params Zoltan parameters which override the defaults. May be NULL.
+* @param phg_stats If non-zero, turn on PHG's output and timers, capture what
+*                  it prints, and report per-phase times, per-level
+*                  hypergraph sizes, and Zoltan_LB_Eval_HG() statistics.
+*                  Level sizes are rank 0's block of PHG's 2D distribution,
+*                  so with more than one rank they are not global sizes.
+*
+* @return parts[v] is the part of local vertex 'v', or NULL if Zoltan failed.
+*         Must be freed!
+*/
 int * partition(
     hgraph * hg,
     MPI_Comm comm,
-    int nparts);
+    int nparts,
+    zparams const * const params,
+    int phg_stats);
+
+#define partition_graph zpart_partition_graph
+/**
+* @brief Partition a distributed hypergraph with Zoltan's graph partitioner
+*        (LB_METHOD=GRAPH) on its star or clique expansion, and report the
+*        hypergraph cut of the result.
+*
+* @param hg The distributed hypergraph.
+* @param comm The communicator the hypergraph is distributed among.
+* @param nparts The number of parts.
+* @param params Zoltan parameters which override the defaults. May be NULL.
+* @param model EXPAND_STAR or EXPAND_CLIQUE.
+* @param cap The largest hyperedge expanded into a full clique.
+*
+* @return parts[v] is the part of local vertex 'v', or NULL if Zoltan failed.
+*         Must be freed!
+*/
+int * partition_graph(
+    hgraph * hg,
+    MPI_Comm comm,
+    int nparts,
+    zparams const * const params,
+    expand_model model,
+    int cap);
 
+/**
+* @brief Write the part of every vertex to a file, one per line, in order of
+*        global vertex ID.
+*
+* @param comm The communicator the hypergraph is distributed among.
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'.
+* @param fname The file to write to.
+*/
 void write_parts(
     MPI_Comm comm,
+    hgraph const * const hg,
     int const * const parts,
-    int nvtxs,
     char const * const fname);
 
 #endif
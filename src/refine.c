@@ -0,0 +1,685 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "refine.h"
+#include "comm.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* same as Zoltan's default IMBALANCE_TOL */
+static double const REFINE_IMBALANCE = 1.10;
+
+/* hyperedges which span more parts than this do not propose targets */
+static int const REFINE_MAX_CONN = 32;
+
+
+/**
+* @brief Per-rank refinement state. Connectivity is stored in the same layout
+*        as eind: hyperedge 'h' has nconn[h] distinct parts, stored in
+*        cparts[eptr[h]:eptr[h]+nconn[h]] with pin counts in ccounts.
+*/
+typedef struct
+{
+  hgraph const * hg;
+  int nparts;
+
+  int * pinparts; /** The part of each local pin. */
+  idx_t * scratch; /** Decodes one hyperedge if the hypergraph is compressed. */
+
+  int * nconn;
+  int * cparts;
+  int * ccounts;
+
+  int * vorder;   /** Local vertices sorted by vertex ID. */
+} refine_ws;
+
+
+/**
+* @brief A proposed move of a local vertex.
+*/
+typedef struct
+{
+  int lid;
+  int to;
+  int gain;
+} move_t;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static idx_t const * __sort_keys;
+
+static int __cmp_by_key(
+    void const * a,
+    void const * b)
+{
+  idx_t const x = __sort_keys[*(int const *) a];
+  idx_t const y = __sort_keys[*(int const *) b];
+  return (x < y) ? -1 : (x > y);
+}
+
+
+/**
+* @brief Return the indices [0, n) sorted by keys[].
+*/
+static int * __argsort(
+    idx_t const * const keys,
+    int n)
+{
+  int * order = (int *) malloc((n+1) * sizeof(int));
+  for(int i=0; i < n; ++i) {
+    order[i] = i;
+  }
+  __sort_keys = keys;
+  qsort(order, n, sizeof(int), __cmp_by_key);
+  return order;
+}
+
+
+/**
+* @brief Find the first position in 'order' whose key is >= 'gid'.
+*/
+static int __lower_bound(
+    idx_t const * const keys,
+    int const * const order,
+    int n,
+    idx_t const gid)
+{
+  int lo = 0;
+  int hi = n;
+  while(lo < hi) {
+    int const mid = lo + ((hi - lo) / 2);
+    if(keys[order[mid]] < gid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+static int __cmp_triplet(
+    void const * a,
+    void const * b)
+{
+  idx_t const * const x = (idx_t const *) a;
+  idx_t const * const y = (idx_t const *) b;
+  for(int i=0; i < 3; ++i) {
+    if(x[i] != y[i]) {
+      return (x[i] < y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+* @brief Find the (v, from, to) update of vertex 'gid' in sorted updates.
+*
+* @return The index of the update, or -1.
+*/
+static int __find_update(
+    idx_t const * const updates,
+    int nupdates,
+    idx_t const gid)
+{
+  int lo = 0;
+  int hi = nupdates;
+  while(lo < hi) {
+    int const mid = lo + ((hi - lo) / 2);
+    if(updates[3*mid] < gid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < nupdates && updates[3*lo] == gid) ? lo : -1;
+}
+
+
+static int __cmp_move(
+    void const * a,
+    void const * b)
+{
+  move_t const * const x = (move_t const *) a;
+  move_t const * const y = (move_t const *) b;
+  if(x->gain != y->gain) {
+    return y->gain - x->gain;
+  }
+  return x->lid - y->lid;
+}
+
+
+/**
+* @brief Add 'delta' pins of part 'p' to hyperedge 'h'.
+*/
+static void __conn_add(
+    refine_ws * const ws,
+    int const h,
+    int const p,
+    int const delta)
+{
+  int const start = ws->hg->eptr[h];
+  int * const cparts = ws->cparts + start;
+  int * const ccounts = ws->ccounts + start;
+
+  for(int i=0; i < ws->nconn[h]; ++i) {
+    if(cparts[i] == p) {
+      ccounts[i] += delta;
+      if(ccounts[i] == 0) {
+        int const last = --ws->nconn[h];
+        cparts[i] = cparts[last];
+        ccounts[i] = ccounts[last];
+      }
+      return;
+    }
+  }
+
+  assert(delta > 0);
+  int const last = ws->nconn[h]++;
+  cparts[last] = p;
+  ccounts[last] = delta;
+}
+
+
+/**
+* @brief Return the number of pins of part 'p' in hyperedge 'h'.
+*/
+static int __conn_count(
+    refine_ws const * const ws,
+    int const h,
+    int const p)
+{
+  int const start = ws->hg->eptr[h];
+  for(int i=0; i < ws->nconn[h]; ++i) {
+    if(ws->cparts[start + i] == p) {
+      return ws->ccounts[start + i];
+    }
+  }
+  return 0;
+}
+
+
+/**
+* @brief Allocate the workspace and compute initial connectivity.
+*/
+static void __ws_init(
+    refine_ws * const ws,
+    hgraph const * const hg,
+    int const * const parts,
+    int nparts,
+    MPI_Comm comm)
+{
+  int const ncon = hg->nlocal_con;
+
+  ws->hg = hg;
+  ws->nparts = nparts;
+  ws->pinparts = comm_pin_lookup(hg, parts, comm);
+  ws->scratch = hgraph_scratch(hg);
+  ws->nconn = (int *) calloc(hg->nlocal_h+1, sizeof(int));
+  ws->cparts = (int *) malloc((ncon+1) * sizeof(int));
+  ws->ccounts = (int *) malloc((ncon+1) * sizeof(int));
+
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      __conn_add(ws, h, ws->pinparts[n], 1);
+    }
+  }
+
+  ws->vorder = __argsort(hg->v_gids, hg->nlocal_v);
+}
+
+
+static void __ws_free(
+    refine_ws * const ws)
+{
+  free(ws->pinparts);
+  free(ws->scratch);
+  free(ws->nconn);
+  free(ws->cparts);
+  free(ws->ccounts);
+  free(ws->vorder);
+}
+
+
+/**
+* @brief Compute the global (lambda-1) cut from the local connectivity.
+*/
+static long long __cut(
+    refine_ws const * const ws,
+    MPI_Comm comm)
+{
+  long long local = 0;
+  for(int h=0; h < ws->hg->nlocal_h; ++h) {
+    if(ws->nconn[h] > 1) {
+      local += ws->nconn[h] - 1;
+    }
+  }
+  long long global;
+  MPI_Allreduce(&local, &global, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  return global;
+}
+
+
+/**
+* @brief Send gain information from each pin to the owner of its vertex. For
+*        a pin (h, v) with v in part 'a' we send (v, part, rank) records:
+*          (v, a)          h contains v (used to compute v's degree)
+*          (v, nparts + a) v is the only pin of h in 'a'
+*          (v, b)          h already contains part 'b'
+*        The sending rank is attached so owners know who holds v's pins.
+*
+* @param ws The workspace.
+* @param pinranks The rank owning the vertex of each pin.
+* @param nrecv [OUT] The number of received records.
+* @param comm The communicator.
+*
+* @return The received records, sorted. Must be freed!
+*/
+static idx_t * __send_gains(
+    refine_ws const * const ws,
+    int const * const pinranks,
+    int * nrecv,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  hgraph const * const hg = ws->hg;
+  int const nparts = ws->nparts;
+
+  /* count records per destination */
+  int * sendcounts = (int *) calloc(npes, sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    int const ncand = (ws->nconn[h] <= REFINE_MAX_CONN) ? ws->nconn[h] : 1;
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      /* degree + candidates (minus own part) + maybe the sole-pin flag */
+      sendcounts[pinranks[n]] += 3 * (1 + ncand);
+    }
+  }
+
+  int * offsets = (int *) malloc((npes+1) * sizeof(int));
+  offsets[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    offsets[p+1] = offsets[p] + sendcounts[p];
+  }
+  idx_t * sendbuf = (idx_t *) malloc((offsets[npes]+1) * sizeof(idx_t));
+
+  memset(sendcounts, 0, npes * sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    int const start = hg->eptr[h];
+    idx_t const * const pins = hg_pins(hg, h, ws->scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      idx_t const gid = pins[n - start];
+      int const dest = pinranks[n];
+      idx_t * rec = sendbuf + offsets[dest] + sendcounts[dest];
+      int const a = ws->pinparts[n];
+      int nrec = 0;
+
+      rec[3*nrec+0] = gid;
+      rec[3*nrec+1] = (idx_t) a;
+      rec[3*nrec+2] = (idx_t) rank;
+      ++nrec;
+
+      if(__conn_count(ws, h, a) == 1) {
+        rec[3*nrec+0] = gid;
+        rec[3*nrec+1] = (idx_t) (nparts + a);
+        rec[3*nrec+2] = (idx_t) rank;
+        ++nrec;
+      }
+
+      if(ws->nconn[h] <= REFINE_MAX_CONN) {
+        for(int i=0; i < ws->nconn[h]; ++i) {
+          int const b = ws->cparts[start + i];
+          if(b != a) {
+            rec[3*nrec+0] = gid;
+            rec[3*nrec+1] = (idx_t) b;
+            rec[3*nrec+2] = (idx_t) rank;
+            ++nrec;
+          }
+        }
+      }
+      sendcounts[dest] += 3 * nrec;
+    }
+  }
+
+  /* compact the buffer, as we over-allocated each destination */
+  int pos = 0;
+  for(int p=0; p < npes; ++p) {
+    memmove(sendbuf + pos, sendbuf + offsets[p],
+        sendcounts[p] * sizeof(idx_t));
+    pos += sendcounts[p];
+  }
+  free(offsets);
+
+  idx_t * recv = comm_exchange(sendbuf, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      nrecv, NULL, comm);
+  free(sendbuf);
+  free(sendcounts);
+
+  *nrecv /= 3;
+  qsort(recv, *nrecv, 3 * sizeof(idx_t), __cmp_triplet);
+  return recv;
+}
+
+
+/**
+* @brief Compute the best move of each local vertex from sorted gain records.
+*
+* @param ws The workspace.
+* @param parts The current parts.
+* @param recs The sorted gain records.
+* @param nrecs The number of records.
+* @param direction Only allow moves to larger (1) or smaller (0) part IDs.
+* @param nmoves [OUT] The number of proposed moves.
+*
+* @return The proposed moves. Must be freed!
+*/
+static move_t * __propose(
+    refine_ws const * const ws,
+    int const * const parts,
+    idx_t const * const recs,
+    int nrecs,
+    int direction,
+    int * nmoves)
+{
+  hgraph const * const hg = ws->hg;
+  int const nparts = ws->nparts;
+  move_t * moves = (move_t *) malloc((hg->nlocal_v+1) * sizeof(move_t));
+  int nm = 0;
+
+  int r = 0;
+  while(r < nrecs) {
+    idx_t const gid = recs[3*r];
+    int const pos = __lower_bound(hg->v_gids, ws->vorder, hg->nlocal_v, gid);
+    assert(pos < hg->nlocal_v && hg->v_gids[ws->vorder[pos]] == gid);
+    int const lid = ws->vorder[pos];
+    int const a = parts[lid];
+
+    int deg = 0;
+    int leave = 0;
+    int best = -1;
+    int best_conn = 0;
+
+    /* records are sorted by part, so candidates are grouped */
+    while(r < nrecs && recs[3*r] == gid) {
+      int const p = (int) recs[3*r + 1];
+      int cnt = 0;
+      while(r < nrecs && recs[3*r] == gid && (int) recs[3*r + 1] == p) {
+        ++cnt;
+        ++r;
+      }
+      if(p == a) {
+        deg = cnt;
+      } else if(p >= nparts) {
+        leave = cnt;
+      } else if((direction && p > a) || (!direction && p < a)) {
+        if(cnt > best_conn) {
+          best_conn = cnt;
+          best = p;
+        }
+      }
+    }
+
+    int const gain = leave - (deg - best_conn);
+    if(best != -1 && gain > 0) {
+      moves[nm].lid = lid;
+      moves[nm].to = best;
+      moves[nm].gain = gain;
+      ++nm;
+    }
+  }
+
+  *nmoves = nm;
+  return moves;
+}
+
+
+/**
+* @brief Notify every rank holding pins of a moved vertex, and update the
+*        connectivity of their hyperedges.
+*
+* @param ws The workspace.
+* @param recs The sorted gain records of this round (for pin holder ranks).
+* @param nrecs The number of records.
+* @param moved moved[v] is the old part of moved local vertex 'v', else -1.
+* @param parts The updated parts.
+* @param comm The communicator.
+*/
+static void __apply_moves(
+    refine_ws * const ws,
+    idx_t const * const recs,
+    int nrecs,
+    int const * const moved,
+    int const * const parts,
+    MPI_Comm comm)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+  hgraph const * const hg = ws->hg;
+
+  /* collect (v, old, new) updates for each distinct pin holder */
+  int * sendcounts = (int *) calloc(npes, sizeof(int));
+  int * dest = (int *) malloc((nrecs+1) * sizeof(int));
+  int * lids = (int *) malloc((nrecs+1) * sizeof(int));
+  int nupdates = 0;
+
+  int r = 0;
+  while(r < nrecs) {
+    idx_t const gid = recs[3*r];
+    int const pos = __lower_bound(hg->v_gids, ws->vorder, hg->nlocal_v, gid);
+    int const lid = ws->vorder[pos];
+
+    int const rstart = r;
+    while(r < nrecs && recs[3*r] == gid) {
+      ++r;
+    }
+    if(moved[lid] == -1) {
+      continue;
+    }
+    for(int i=rstart; i < r; ++i) {
+      /* every pin sends one record of its old part, sorted by rank */
+      if((int) recs[3*i + 1] != moved[lid]) {
+        continue;
+      }
+      int const p = (int) recs[3*i + 2];
+      if(nupdates > 0 && lids[nupdates-1] == lid && dest[nupdates-1] == p) {
+        continue;
+      }
+      dest[nupdates] = p;
+      lids[nupdates] = lid;
+      ++nupdates;
+    }
+  }
+
+  int * perm = comm_bucket(dest, nupdates, sendcounts, comm);
+  idx_t * sendbuf = (idx_t *) malloc((3*nupdates+1) * sizeof(idx_t));
+  for(int u=0; u < nupdates; ++u) {
+    sendbuf[3*perm[u] + 0] = hg->v_gids[lids[u]];
+    sendbuf[3*perm[u] + 1] = (idx_t) moved[lids[u]];
+    sendbuf[3*perm[u] + 2] = (idx_t) parts[lids[u]];
+  }
+  free(perm);
+  free(dest);
+  free(lids);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 3;
+  }
+
+  int nrecv;
+  idx_t * recv = comm_exchange(sendbuf, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nrecv, NULL, comm);
+  free(sendbuf);
+  free(sendcounts);
+  nrecv /= 3;
+
+  /* update each pin of the moved vertices, walking the pins hyperedge by
+   * hyperedge so a compressed hypergraph is never decoded in full */
+  qsort(recv, nrecv, 3 * sizeof(idx_t), __cmp_triplet);
+  for(int h=0; h < hg->nlocal_h && nrecv > 0; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, ws->scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      int const u = __find_update(recv, nrecv, pins[n - hg->eptr[h]]);
+      if(u < 0) {
+        continue;
+      }
+      int const from = (int) recv[3*u + 1];
+      int const to = (int) recv[3*u + 2];
+      assert(ws->pinparts[n] == from);
+      __conn_add(ws, h, from, -1);
+      __conn_add(ws, h, to, 1);
+      ws->pinparts[n] = to;
+    }
+  }
+  free(recv);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+void refine_parts(
+    hgraph const * const hg,
+    int * const parts,
+    int nparts,
+    int max_rounds,
+    double max_seconds,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  MPI_Barrier(comm);
+  zp_timer_t ref_time;
+  timer_fstart(&ref_time);
+
+  refine_ws ws;
+  __ws_init(&ws, hg, parts, nparts, comm);
+
+  /* the rank of each pin's vertex never changes, so look it up once */
+  int * vranks = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vranks[v] = rank;
+  }
+  int * pinranks = comm_pin_lookup(hg, vranks, comm);
+  free(vranks);
+
+  long long const cut_before = __cut(&ws, comm);
+
+  /* part weights and the balance constraint */
+  int * lweights = (int *) malloc(nparts * sizeof(int));
+  int * weights = (int *) malloc(nparts * sizeof(int));
+  int * linflow = (int *) malloc(nparts * sizeof(int));
+  int * offset = (int *) malloc(nparts * sizeof(int));
+  int * moved = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  int const maxw = (int) (REFINE_IMBALANCE *
+      (double) ((hg->nglobal_v + nparts - 1) / nparts));
+
+  long long total_moves = 0;
+  int idle = 0;
+  int round;
+  for(round=0; round < max_rounds; ++round) {
+    memset(lweights, 0, nparts * sizeof(int));
+    for(int v=0; v < hg->nlocal_v; ++v) {
+      ++lweights[parts[v]];
+    }
+    MPI_Allreduce(lweights, weights, nparts, MPI_INT, MPI_SUM, comm);
+
+    int nrecs;
+    idx_t * recs = __send_gains(&ws, pinranks, &nrecs, comm);
+
+    int nmoves;
+    move_t * moves = __propose(&ws, parts, recs, nrecs, round % 2, &nmoves);
+    qsort(moves, nmoves, sizeof(*moves), __cmp_move);
+
+    /* ranks take turns filling the room left in each part */
+    memset(linflow, 0, nparts * sizeof(int));
+    for(int m=0; m < nmoves; ++m) {
+      ++linflow[moves[m].to];
+    }
+    MPI_Exscan(linflow, offset, nparts, MPI_INT, MPI_SUM, comm);
+    if(rank == 0) {
+      memset(offset, 0, nparts * sizeof(int));
+    }
+
+    for(int v=0; v < hg->nlocal_v; ++v) {
+      moved[v] = -1;
+    }
+    int naccepted = 0;
+    for(int m=0; m < nmoves; ++m) {
+      int const to = moves[m].to;
+      if(weights[to] + offset[to] < maxw) {
+        moved[moves[m].lid] = parts[moves[m].lid];
+        parts[moves[m].lid] = to;
+        ++naccepted;
+      }
+      ++offset[to];
+    }
+    free(moves);
+
+    __apply_moves(&ws, recs, nrecs, moved, parts, comm);
+    free(recs);
+
+    long long lmoves = naccepted;
+    long long gmoves;
+    MPI_Allreduce(&lmoves, &gmoves, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    total_moves += gmoves;
+
+    /* stop after a round in each direction without progress */
+    idle = (gmoves == 0) ? idle + 1 : 0;
+    if(idle == 2) {
+      ++round;
+      break;
+    }
+
+    /* everyone agrees on the slowest clock */
+    if(max_seconds > 0) {
+      timer_stop(&ref_time);
+      timer_start(&ref_time);
+      double elapsed;
+      MPI_Allreduce(&ref_time.seconds, &elapsed, 1, MPI_DOUBLE, MPI_MAX, comm);
+      if(elapsed >= max_seconds) {
+        ++round;
+        break;
+      }
+    }
+  }
+
+  long long const cut_after = __cut(&ws, comm);
+
+  free(lweights);
+  free(weights);
+  free(linflow);
+  free(offset);
+  free(moved);
+  free(pinranks);
+  __ws_free(&ws);
+
+  MPI_Barrier(comm);
+  timer_stop(&ref_time);
+  if(rank == 0) {
+    printf("Refinement: %d rounds, %lld moves, (lambda-1) cut %lld -> %lld\n",
+        round, total_moves, cut_before, cut_after);
+    printf("Refinement time: %0.3fs\n", ref_time.seconds);
+  }
+}
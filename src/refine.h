@@ -0,0 +1,41 @@
+#ifndef ZPART_REFINE_H
+#define ZPART_REFINE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define refine_parts zpart_refine_parts
+/**
+* @brief Improve a partition with rounds of parallel, greedy (lambda-1) gain
+*        moves. Ranks keep the part connectivity of their local hyperedges and
+*        update it incrementally as vertices move. Each round, vertex owners
+*        collect gains from the ranks holding their pins and move to the best
+*        positive-gain part. Moves alternate between increasing and decreasing
+*        part IDs to avoid oscillation, and are capped so that no part grows
+*        past the imbalance tolerance.
+*
+* @param hg The distributed hypergraph.
+* @param parts parts[v] is the part of local vertex 'v'. Updated in place.
+* @param nparts The number of parts.
+* @param max_rounds The maximum number of rounds to perform.
+* @param max_seconds Stop after this many seconds. Ignored if <= 0.
+* @param comm The communicator the hypergraph is distributed among.
+*/
+void refine_parts(
+    hgraph const * const hg,
+    int * const parts,
+    int nparts,
+    int max_rounds,
+    double max_seconds,
+    MPI_Comm comm);
+
+#endif
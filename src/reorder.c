@@ -0,0 +1,675 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "reorder.h"
+#include "comm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* ranks may not own more than this factor of the average number of vertices
+ * under reorder_owners() */
+static double const OWNER_IMBALANCE = 1.05;
+
+/* rounds of proposals before leftover vertices fill the remaining space */
+static int const OWNER_ROUNDS = 4;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Return the first index of rank 'r' when 'n' items are split into
+*        contiguous blocks.
+*/
+static inline long long __block_start(
+    long long n,
+    int r,
+    int npes)
+{
+  return (n * r) / npes;
+}
+
+
+/**
+* @brief Return the rank owning index 'i' when 'n' items are split into
+*        contiguous blocks.
+*/
+static int __block_owner(
+    long long i,
+    long long n,
+    int npes)
+{
+  int r = (int) ((i * npes) / n);
+  while(r+1 < npes && __block_start(n, r+1, npes) <= i) {
+    ++r;
+  }
+  while(r > 0 && __block_start(n, r, npes) > i) {
+    --r;
+  }
+  return r;
+}
+
+
+static int __cmp_pair(
+    void const * a,
+    void const * b)
+{
+  long long const * const x = (long long const *) a;
+  long long const * const y = (long long const *) b;
+  if(x[0] != y[0]) {
+    return (x[0] < y[0]) ? -1 : 1;
+  }
+  if(x[1] != y[1]) {
+    return (x[1] < y[1]) ? -1 : 1;
+  }
+  return 0;
+}
+
+
+static int __cmp_triple(
+    void const * a,
+    void const * b)
+{
+  int const cmp = __cmp_pair(a, b);
+  if(cmp != 0) {
+    return cmp;
+  }
+  long long const x = ((long long const *) a)[2];
+  long long const y = ((long long const *) b)[2];
+  return (x < y) ? -1 : (x > y);
+}
+
+
+static int __cmp_idx(
+    void const * a,
+    void const * b)
+{
+  idx_t const x = *((idx_t const *) a);
+  idx_t const y = *((idx_t const *) b);
+  return (x < y) ? -1 : (x > y);
+}
+
+
+/**
+* @brief Return the fraction of pins whose vertex is owned by the rank
+*        holding the hyperedge.
+*/
+static double __local_pins(
+    hgraph const * const hg,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  int * vals = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vals[v] = rank;
+  }
+  int * pinowner = comm_pin_lookup(hg, vals, comm);
+  free(vals);
+
+  long long counts[2] = {0, hg->nlocal_con};
+  for(int n=0; n < hg->nlocal_con; ++n) {
+    if(pinowner[n] == rank) {
+      ++counts[0];
+    }
+  }
+  free(pinowner);
+  MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_LONG_LONG, MPI_SUM, comm);
+  return (counts[1] > 0) ? (double) counts[0] / (double) counts[1] : 1.;
+}
+
+
+/**
+* @brief Find the global position of each item when all items are sorted by
+*        (key, id). Items are bucketed to ranks by key range, sorted there,
+*        and positions are sent back.
+*
+* @param keys The key of each local item, in [0, keyspace).
+* @param ids The ID of each local item, to break ties.
+* @param nitems The number of local items.
+* @param keyspace One more than the largest possible key.
+* @param comm The communicator.
+*
+* @return The global position of each item. Must be freed!
+*/
+static long long * __global_rank(
+    long long const * const keys,
+    idx_t const * const ids,
+    int nitems,
+    long long keyspace,
+    MPI_Comm comm)
+{
+  int npes;
+  MPI_Comm_size(comm, &npes);
+
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * recvcounts = (int *) malloc(npes * sizeof(int));
+
+  int * dest = (int *) malloc((nitems+1) * sizeof(int));
+  for(int i=0; i < nitems; ++i) {
+    dest[i] = __block_owner(keys[i], keyspace, npes);
+  }
+  int * perm = comm_bucket(dest, nitems, sendcounts, comm);
+  free(dest);
+  long long * send = (long long *) malloc((2*nitems+1) * sizeof(long long));
+  for(int i=0; i < nitems; ++i) {
+    send[2*perm[i] + 0] = keys[i];
+    send[2*perm[i] + 1] = (long long) ids[i];
+  }
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nrecv;
+  long long * recv = comm_exchange(send, sendcounts, MPI_LONG_LONG, &nrecv,
+      recvcounts, comm);
+  free(send);
+  nrecv /= 2;
+
+  /* sort (key, id, position) triples to find each item's place */
+  long long * sorted = (long long *) malloc((3*nrecv+1) * sizeof(long long));
+  for(int i=0; i < nrecv; ++i) {
+    sorted[3*i + 0] = recv[2*i + 0];
+    sorted[3*i + 1] = recv[2*i + 1];
+    sorted[3*i + 2] = i;
+  }
+  free(recv);
+  qsort(sorted, nrecv, 3 * sizeof(long long), __cmp_pair);
+
+  long long offset = 0;
+  long long mine = nrecv;
+  MPI_Exscan(&mine, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if(rank == 0) {
+    offset = 0;
+  }
+
+  long long * answers = (long long *) malloc((nrecv+1) * sizeof(long long));
+  for(int i=0; i < nrecv; ++i) {
+    answers[sorted[3*i + 2]] = offset + i;
+  }
+  free(sorted);
+
+  /* answers are in the order we received them, so send them right back */
+  for(int p=0; p < npes; ++p) {
+    recvcounts[p] /= 2;
+  }
+  int nback;
+  long long * back = comm_exchange(answers, recvcounts, MPI_LONG_LONG, &nback,
+      NULL, comm);
+  free(answers);
+  assert(nback == nitems);
+
+  long long * ranks = (long long *) malloc((nitems+1) * sizeof(long long));
+  for(int i=0; i < nitems; ++i) {
+    ranks[i] = back[perm[i]];
+  }
+  free(back);
+  free(perm);
+  free(sendcounts);
+  free(recvcounts);
+
+  return ranks;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+hgraph * reorder_hgraph(
+    hgraph const * const hg,
+    int rounds,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  long long totals[2];
+  totals[0] = hg->nlocal_v;
+  totals[1] = hg->nlocal_h;
+  MPI_Allreduce(MPI_IN_PLACE, totals, 2, MPI_LONG_LONG, MPI_SUM, comm);
+  long long const nvtxs = totals[0];
+  long long const nhedges = totals[1];
+  long long const nglobal_v = (long long) hg->nglobal_v;
+
+  /* find where each pin lives, to send it vertex keys */
+  int * vals = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vals[v] = rank;
+  }
+  int * pinowner = comm_pin_lookup(hg, vals, comm);
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    vals[v] = v;
+  }
+  int * pinlid = comm_pin_lookup(hg, vals, comm);
+
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * perm = comm_bucket(pinowner, hg->nlocal_con, sendcounts, comm);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  free(pinowner);
+
+  /* vertices start labeled by their IDs */
+  idx_t * scratch = hgraph_scratch(hg);
+  int * pinlabel = (int *) malloc((hg->nlocal_con+1) * sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+      pinlabel[n] = (int) pins[n - hg->eptr[h]];
+    }
+  }
+
+  long long * newh = NULL;
+  long long * newv = NULL;
+  for(int round=0; round < rounds; ++round) {
+    /* order hyperedges by their smallest pin label; empty ones go last */
+    long long * keys = (long long *) malloc((hg->nlocal_h+1) *
+        sizeof(long long));
+    for(int h=0; h < hg->nlocal_h; ++h) {
+      keys[h] = nglobal_v;
+      for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+        if(pinlabel[n] < keys[h]) {
+          keys[h] = pinlabel[n];
+        }
+      }
+    }
+    free(newh);
+    newh = __global_rank(keys, hg->h_gids, hg->nlocal_h, nglobal_v + 1, comm);
+    free(keys);
+
+    /* order vertices by the first hyperedge containing them */
+    long long * send = (long long *) malloc((2*hg->nlocal_con+1) *
+        sizeof(long long));
+    for(int h=0; h < hg->nlocal_h; ++h) {
+      for(int n=hg->eptr[h]; n < hg->eptr[h+1]; ++n) {
+        send[2*perm[n] + 0] = pinlid[n];
+        send[2*perm[n] + 1] = newh[h];
+      }
+    }
+    int nrecv;
+    long long * recv = comm_exchange(send, sendcounts, MPI_LONG_LONG, &nrecv,
+        NULL, comm);
+    free(send);
+
+    /* vertices without pins go last, in ID order */
+    keys = (long long *) malloc((hg->nlocal_v+1) * sizeof(long long));
+    for(int v=0; v < hg->nlocal_v; ++v) {
+      keys[v] = nhedges + (long long) hg->v_gids[v];
+    }
+    for(int i=0; i < nrecv / 2; ++i) {
+      int const v = (int) recv[2*i];
+      if(recv[2*i + 1] < keys[v]) {
+        keys[v] = recv[2*i + 1];
+      }
+    }
+    free(recv);
+    free(newv);
+    newv = __global_rank(keys, hg->v_gids, hg->nlocal_v, nhedges + nglobal_v,
+        comm);
+    free(keys);
+
+    /* relabel vertices by their new position for the next round */
+    if(round+1 < rounds) {
+      for(int v=0; v < hg->nlocal_v; ++v) {
+        vals[v] = (int) newv[v];
+      }
+      free(pinlabel);
+      pinlabel = comm_pin_lookup(hg, vals, comm);
+    }
+  }
+  free(pinlabel);
+  free(pinlid);
+  free(perm);
+  free(vals);
+
+  /* send vertices to the owners of their new positions */
+  int * dest = (int *) malloc((hg->nlocal_v+1) * sizeof(int));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    dest[v] = __block_owner(newv[v], nvtxs, npes);
+  }
+  perm = comm_bucket(dest, hg->nlocal_v, sendcounts, comm);
+  free(dest);
+  long long * send = (long long *) malloc((2*hg->nlocal_v+1) *
+      sizeof(long long));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    send[2*perm[v] + 0] = newv[v];
+    send[2*perm[v] + 1] = (long long) hg->v_gids[v];
+  }
+  free(perm);
+  free(newv);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nrecv;
+  long long * rvtxs = comm_exchange(send, sendcounts, MPI_LONG_LONG, &nrecv,
+      NULL, comm);
+  free(send);
+  int const nlocal_v = nrecv / 2;
+  long long const vstart = __block_start(nvtxs, rank, npes);
+  assert(nlocal_v == __block_start(nvtxs, rank+1, npes) - vstart);
+
+  /* send hyperedges (and their pins, in the same order) to their new owners */
+  dest = (int *) malloc((hg->nlocal_h+1) * sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    dest[h] = __block_owner(newh[h], nhedges, npes);
+  }
+  perm = comm_bucket(dest, hg->nlocal_h, sendcounts, comm);
+  send = (long long *) malloc((3*hg->nlocal_h+1) * sizeof(long long));
+  int * pincounts = (int *) calloc(npes, sizeof(int));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    send[3*perm[h] + 0] = newh[h];
+    send[3*perm[h] + 1] = (long long) hg->h_gids[h];
+    send[3*perm[h] + 2] = hg->eptr[h+1] - hg->eptr[h];
+    pincounts[dest[h]] += hg->eptr[h+1] - hg->eptr[h];
+  }
+  free(perm);
+  free(newh);
+
+  /* bucketing is stable, so pins follow hyperedges in index order */
+  int * offsets = (int *) malloc((npes+1) * sizeof(int));
+  offsets[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    offsets[p+1] = offsets[p] + pincounts[p];
+  }
+  idx_t * spins = (idx_t *) malloc((hg->nlocal_con+1) * sizeof(idx_t));
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    idx_t const * const pins = hg_pins(hg, h, scratch);
+    int const len = hg->eptr[h+1] - hg->eptr[h];
+    memcpy(spins + offsets[dest[h]], pins, len * sizeof(idx_t));
+    offsets[dest[h]] += len;
+  }
+  free(offsets);
+  free(dest);
+  free(scratch);
+
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 3;
+  }
+  int nrecv_h;
+  long long * rhedges = comm_exchange(send, sendcounts, MPI_LONG_LONG,
+      &nrecv_h, NULL, comm);
+  free(send);
+  int nrecv_pins;
+  idx_t * rpins = comm_exchange(spins, pincounts, ZOLTAN_ID_MPI_TYPE,
+      &nrecv_pins, NULL, comm);
+  free(spins);
+  free(pincounts);
+  free(sendcounts);
+
+  int const nlocal_h = nrecv_h / 3;
+  long long const hstart = __block_start(nhedges, rank, npes);
+  assert(nlocal_h == __block_start(nhedges, rank+1, npes) - hstart);
+
+  /* place everything at its new local position */
+  hgraph * out = hgraph_alloc(nlocal_v, nlocal_h, nrecv_pins);
+  out->nglobal_v = hg->nglobal_v;
+  out->nglobal_h = hg->nglobal_h;
+  for(int i=0; i < nlocal_v; ++i) {
+    out->v_gids[rvtxs[2*i] - vstart] = (idx_t) rvtxs[2*i + 1];
+  }
+  free(rvtxs);
+
+  int * start = (int *) malloc((nlocal_h+1) * sizeof(int));
+  memset(out->eptr, 0, (nlocal_h+1) * sizeof(int));
+  int cursor = 0;
+  for(int i=0; i < nlocal_h; ++i) {
+    int const h = (int) (rhedges[3*i] - hstart);
+    out->h_gids[h] = (idx_t) rhedges[3*i + 1];
+    out->eptr[h+1] = (int) rhedges[3*i + 2];
+    start[i] = cursor;
+    cursor += (int) rhedges[3*i + 2];
+  }
+  assert(cursor == nrecv_pins);
+  for(int h=0; h < nlocal_h; ++h) {
+    out->eptr[h+1] += out->eptr[h];
+  }
+  for(int i=0; i < nlocal_h; ++i) {
+    int const h = (int) (rhedges[3*i] - hstart);
+    memcpy(out->eind + out->eptr[h], rpins + start[i],
+        (out->eptr[h+1] - out->eptr[h]) * sizeof(idx_t));
+  }
+  free(start);
+  free(rhedges);
+  free(rpins);
+
+  double const before = __local_pins(hg, comm);
+  double const after = __local_pins(out, comm);
+  if(rank == 0) {
+    printf("Reorder: %0.1f%% -> %0.1f%% of pins owned by their hyperedge's "
+        "rank\n", 100. * before, 100. * after);
+  }
+
+  return out;
+}
+
+
+
+void reorder_owners(
+    hgraph * const hg,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  assert(hg->layout == ZOLTAN_COMPRESSED_EDGE);
+
+  long long const nvtxs = (long long) hg->nglobal_v;
+  double const before = __local_pins(hg, comm);
+
+  /* count my pins of each vertex, as (vertex, count) pairs */
+  idx_t * pins = (idx_t *) malloc((hg->nlocal_con+1) * sizeof(idx_t));
+  idx_t * scratch = hgraph_scratch(hg);
+  for(int h=0; h < hg->nlocal_h; ++h) {
+    memcpy(pins + hg->eptr[h], hg_pins(hg, h, scratch),
+        (hg->eptr[h+1] - hg->eptr[h]) * sizeof(idx_t));
+  }
+  free(scratch);
+  qsort(pins, hg->nlocal_con, sizeof(idx_t), __cmp_idx);
+
+  long long * counts = (long long *) malloc((2*hg->nlocal_con+1) *
+      sizeof(long long));
+  int ncounts = 0;
+  for(int n=0; n < hg->nlocal_con; ++n) {
+    if(n == 0 || pins[n] != pins[n-1]) {
+      counts[2*ncounts + 0] = (long long) pins[n];
+      counts[2*ncounts + 1] = 0;
+      ++ncounts;
+    }
+    ++counts[2*(ncounts-1) + 1];
+  }
+  free(pins);
+
+  /* send the counts to a directory which is block-distributed by vertex ID */
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * recvcounts = (int *) malloc(npes * sizeof(int));
+  int * dest = (int *) malloc((ncounts+1) * sizeof(int));
+  for(int i=0; i < ncounts; ++i) {
+    dest[i] = __block_owner(counts[2*i], nvtxs, npes);
+  }
+  int * perm = comm_bucket(dest, ncounts, sendcounts, comm);
+  free(dest);
+  long long * send = (long long *) malloc((2*ncounts+1) * sizeof(long long));
+  for(int i=0; i < ncounts; ++i) {
+    send[2*perm[i] + 0] = counts[2*i + 0];
+    send[2*perm[i] + 1] = counts[2*i + 1];
+  }
+  free(perm);
+  free(counts);
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nrecv;
+  long long * recv = comm_exchange(send, sendcounts, MPI_LONG_LONG, &nrecv,
+      recvcounts, comm);
+  free(send);
+  nrecv /= 2;
+
+  /* candidates of each of my directory vertices, as (-count, rank) pairs so
+   * that the rank with the most pins comes first */
+  long long const vstart = __block_start(nvtxs, rank, npes);
+  int const nv = (int) (__block_start(nvtxs, rank+1, npes) - vstart);
+  int * cptr = (int *) calloc(nv+2, sizeof(int));
+  for(int i=0; i < nrecv; ++i) {
+    ++cptr[recv[2*i] - vstart + 2];
+  }
+  for(int v=0; v < nv; ++v) {
+    cptr[v+2] += cptr[v+1];
+  }
+  long long * cands = (long long *) malloc((2*nrecv+1) * sizeof(long long));
+  for(int p=0, i=0; p < npes; ++p) {
+    for(int end=i + recvcounts[p]/2; i < end; ++i) {
+      int const c = cptr[recv[2*i] - vstart + 1]++;
+      cands[2*c + 0] = -recv[2*i + 1];
+      cands[2*c + 1] = p;
+    }
+  }
+  free(recv);
+  free(sendcounts);
+  free(recvcounts);
+  for(int v=0; v < nv; ++v) {
+    qsort(cands + 2*cptr[v], cptr[v+1] - cptr[v], 2 * sizeof(long long),
+        __cmp_pair);
+  }
+
+  /* each round, unassigned vertices propose to their best remaining rank, and
+   * ranks with too many proposals split their space among directories */
+  long long const cap = (long long) (OWNER_IMBALANCE * nvtxs / npes) + 1;
+  long long * room = (long long *) malloc(npes * sizeof(long long));
+  long long * props = (long long *) malloc(npes * sizeof(long long));
+  long long * total = (long long *) malloc(npes * sizeof(long long));
+  for(int p=0; p < npes; ++p) {
+    room[p] = cap;
+  }
+  int * owner = (int *) malloc((nv+1) * sizeof(int));
+  int * next = (int *) malloc((nv+1) * sizeof(int));
+  for(int v=0; v < nv; ++v) {
+    owner[v] = -1;
+    next[v] = cptr[v];
+  }
+  long long * offers = (long long *) malloc((3*nv+1) * sizeof(long long));
+  for(int round=0; round < OWNER_ROUNDS; ++round) {
+    int noffers = 0;
+    memset(props, 0, npes * sizeof(long long));
+    for(int v=0; v < nv; ++v) {
+      if(owner[v] < 0 && next[v] < cptr[v+1]) {
+        int const p = (int) cands[2*next[v] + 1];
+        offers[3*noffers + 0] = p;
+        offers[3*noffers + 1] = cands[2*next[v] + 0];
+        offers[3*noffers + 2] = v;
+        ++noffers;
+        ++props[p];
+      }
+    }
+    MPI_Allreduce(props, total, npes, MPI_LONG_LONG, MPI_SUM, comm);
+    long long nprops = 0;
+    for(int p=0; p < npes; ++p) {
+      nprops += total[p];
+    }
+    if(nprops == 0) {
+      break;
+    }
+
+    /* accept the offers with the most pins first */
+    qsort(offers, noffers, 3 * sizeof(long long), __cmp_triple);
+    for(int i=0; i < noffers; ) {
+      int const p = (int) offers[3*i];
+      long long const quota = (total[p] <= room[p]) ? props[p] :
+          (room[p] * props[p]) / total[p];
+      long long taken = 0;
+      for(; i < noffers && offers[3*i] == p; ++i) {
+        int const v = (int) offers[3*i + 2];
+        if(taken < quota) {
+          owner[v] = p;
+          ++taken;
+        } else {
+          ++next[v];
+        }
+      }
+      props[p] = taken;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, props, npes, MPI_LONG_LONG, MPI_SUM, comm);
+    for(int p=0; p < npes; ++p) {
+      room[p] -= props[p];
+    }
+  }
+  free(offers);
+  free(cands);
+  free(cptr);
+  free(next);
+  free(props);
+  free(total);
+
+  /* everything left over, including vertices without pins, fills the
+   * remaining space in rank order */
+  long long nleft = 0;
+  for(int v=0; v < nv; ++v) {
+    nleft += (owner[v] < 0);
+  }
+  long long offset = 0;
+  MPI_Exscan(&nleft, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  if(rank == 0) {
+    offset = 0;
+  }
+  int p = 0;
+  long long filled = 0;
+  for(int v=0; v < nv; ++v) {
+    if(owner[v] >= 0) {
+      continue;
+    }
+    while(filled + room[p] <= offset) {
+      filled += room[p];
+      ++p;
+    }
+    owner[v] = p;
+    ++offset;
+  }
+  free(room);
+
+  /* tell each vertex's new owner */
+  sendcounts = (int *) malloc(npes * sizeof(int));
+  perm = comm_bucket(owner, nv, sendcounts, comm);
+  free(owner);
+  idx_t * sgids = (idx_t *) malloc((nv+1) * sizeof(idx_t));
+  for(int v=0; v < nv; ++v) {
+    sgids[perm[v]] = (idx_t) (vstart + v);
+  }
+  free(perm);
+  int nlocal_v;
+  idx_t * gids = comm_exchange(sgids, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nlocal_v, NULL, comm);
+  free(sgids);
+  free(sendcounts);
+  qsort(gids, nlocal_v, sizeof(idx_t), __cmp_idx);
+
+  free(hg->v_gids);
+  hg->v_gids = gids;
+  hg->nlocal_v = nlocal_v;
+
+  double const after = __local_pins(hg, comm);
+  int maxv = nlocal_v;
+  MPI_Reduce(&nlocal_v, &maxv, 1, MPI_INT, MPI_MAX, 0, comm);
+  if(rank == 0) {
+    printf("Vertex owners: %0.1f%% -> %0.1f%% of pins owned by their "
+        "hyperedge's rank, at most %d vertices per rank\n", 100. * before,
+        100. * after, maxv);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef ZPART_REORDER_H
+#define ZPART_REORDER_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define reorder_hgraph zpart_reorder_hgraph
+/**
+* @brief Redistribute a hypergraph in a locality-improving order. Hyperedges
+*        are ordered by their smallest pin label, and vertices by the first
+*        hyperedge (in that order) which contains them. Vertices are then
+*        relabeled by their position and the process repeats, so each round
+*        follows the incidence graph one level further, like a BFS. Each rank
+*        then owns a contiguous block of each order, stored locally in that
+*        order.
+*
+*        Global IDs are not changed, so Zoltan sees the same hypergraph and
+*        parts are still written in the original vertex order. Only ownership
+*        and the local order change.
+*
+* @param hg The distributed hypergraph.
+* @param rounds The number of relabeling rounds (at least 1).
+* @param comm The communicator the hypergraph is distributed among.
+*
+* @return The reordered hypergraph, uncompressed and in the compressed-edge
+*         layout. Must be freed with hgraph_free()!
+*/
+hgraph * reorder_hgraph(
+    hgraph const * const hg,
+    int rounds,
+    MPI_Comm comm);
+
+
+#define reorder_owners zpart_reorder_owners
+/**
+* @brief Give each vertex to the rank holding the most of its pins, so that
+*        vertices are owned where their hyperedges are (owner-computes).
+*        Pin counts are sent to a directory, which is block-distributed by
+*        vertex ID. In each of a few rounds, unassigned vertices propose to
+*        their best remaining rank. A rank with more proposals than room
+*        takes those with the most pins, up to OWNER_IMBALANCE times the
+*        average number of vertices. Leftover vertices, and vertices without
+*        pins, fill the remaining room. Hyperedges do not move.
+*
+* @param hg The distributed hypergraph, in the compressed-edge layout. Its
+*           vertices are replaced.
+* @param comm The communicator the hypergraph is distributed among.
+*/
+void reorder_owners(
+    hgraph * const hg,
+    MPI_Comm comm);
+
+#endif
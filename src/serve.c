@@ -0,0 +1,727 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "serve.h"
+#include "refine.h"
+#include "map.h"
+#include "reorder.h"
+#include "timer.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* the longest request we accept, in bytes */
+#define SERVE_MAX_REQUEST 4096
+
+/* the most whitespace-separated tokens in one request */
+#define SERVE_MAX_TOKENS 256
+
+/* the longest reply we send, in bytes */
+#define SERVE_MAX_REPLY 512
+
+
+/**
+* @brief A resident hypergraph.
+*/
+typedef struct
+{
+  char * fname;                /** The file it was loaded from. */
+  hgraph * hg;                 /** The loaded hypergraph. */
+  unsigned long long last_use; /** The request which last used it. */
+} serve_entry;
+
+
+/**
+* @brief The resident hypergraphs. Every rank holds the same list, in the same
+*        order, because every rank handles the same requests.
+*/
+typedef struct
+{
+  serve_entry * entries;
+  int nentries;
+  int max_entries;
+  unsigned long long clock;
+} serve_registry;
+
+
+/**
+* @brief The client connection, which only exists on rank 0.
+*/
+typedef struct
+{
+  int lfd;      /** The listening socket. */
+  FILE * in;    /** Requests from the current client, or NULL. */
+  FILE * out;   /** Replies to the current client, or NULL. */
+} serve_conn;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Return the format of 'fname', guessing from its extension if the
+*        server was not given one.
+*/
+static char const * __format(
+    char const * const fname,
+    serve_opts const * const opts)
+{
+  if(opts->format != NULL) {
+    return opts->format;
+  }
+  char const * const ext = strrchr(fname, '.');
+  if(ext != NULL && strcmp(ext, ".mtx") == 0) {
+    return "mtx";
+  } else if(ext != NULL && strcmp(ext, ".patoh") == 0) {
+    return "patoh";
+  }
+  return "hmetis";
+}
+
+
+/**
+* @brief Load a hypergraph the same way a normal run does: read, reorder,
+*        move vertex owners, choose the layout, and compress.
+*
+* @return The hypergraph, or NULL if it could not be read.
+*/
+static hgraph * __load(
+    char const * const fname,
+    serve_opts const * const opts,
+    MPI_Comm comm)
+{
+  char const * const format = __format(fname, opts);
+
+  hgraph * hg = NULL;
+  if(strcmp(format, "hmetis") == 0) {
+    hg = distribute_hgraph(fname, opts->validate, comm);
+  } else if(strcmp(format, "mtx") == 0) {
+    hg = distribute_mtx(fname, opts->model, opts->validate, comm);
+  } else if(strcmp(format, "patoh") == 0) {
+    hg = distribute_patoh(fname, opts->validate, comm);
+  }
+  if(hg == NULL) {
+    return NULL;
+  }
+
+  if(opts->reorder_rounds > 0) {
+    hgraph * reordered = reorder_hgraph(hg, opts->reorder_rounds, comm);
+    hgraph_free(hg);
+    hg = reordered;
+  }
+
+  if(opts->owner_pins) {
+    reorder_owners(hg, comm);
+  }
+
+  int fmt = ZOLTAN_COMPRESSED_EDGE;
+  if(strcmp(opts->layout, "vertex") == 0) {
+    fmt = ZOLTAN_COMPRESSED_VERTEX;
+  } else if(strcmp(opts->layout, "auto") == 0) {
+    fmt = hgraph_choose_layout(hg, comm);
+  }
+  if(fmt == ZOLTAN_COMPRESSED_VERTEX) {
+    hgraph_transpose(hg, comm);
+  }
+
+  if(opts->compress) {
+    hgraph_compress(hg);
+  }
+
+  return hg;
+}
+
+
+/**
+* @brief Return the index of 'fname' in the registry, or -1.
+*/
+static int __find(
+    serve_registry const * const reg,
+    char const * const fname)
+{
+  for(int i=0; i < reg->nentries; ++i) {
+    if(strcmp(reg->entries[i].fname, fname) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+/**
+* @brief Drop entry 'i' from the registry.
+*/
+static void __evict(
+    serve_registry * const reg,
+    int i)
+{
+  free(reg->entries[i].fname);
+  hgraph_free(reg->entries[i].hg);
+  reg->entries[i] = reg->entries[--reg->nentries];
+}
+
+
+/**
+* @brief Return the resident hypergraph of 'fname', loading it if needed. If
+*        we are full, the least recently used one is evicted before loading,
+*        even if the load then fails.
+*
+* @param reg The registry.
+* @param fname The file to load from.
+* @param opts How to load it.
+* @param comm The communicator.
+* @param loaded [OUT] Set to 1 if the hypergraph had to be loaded.
+*
+* @return The hypergraph, or NULL if it could not be loaded.
+*/
+static hgraph * __get(
+    serve_registry * const reg,
+    char const * const fname,
+    serve_opts const * const opts,
+    MPI_Comm comm,
+    int * const loaded)
+{
+  ++reg->clock;
+
+  int i = __find(reg, fname);
+  *loaded = (i < 0);
+  if(i < 0) {
+    /* make room first, so no more than max_entries are ever loaded */
+    if(reg->nentries == reg->max_entries) {
+      int lru = 0;
+      for(int j=1; j < reg->nentries; ++j) {
+        if(reg->entries[j].last_use < reg->entries[lru].last_use) {
+          lru = j;
+        }
+      }
+      __evict(reg, lru);
+    }
+
+    hgraph * hg = __load(fname, opts, comm);
+    if(hg == NULL) {
+      return NULL;
+    }
+
+    i = reg->nentries++;
+    reg->entries[i].fname = strdup(fname);
+    reg->entries[i].hg = hg;
+  }
+
+  reg->entries[i].last_use = reg->clock;
+  return reg->entries[i].hg;
+}
+
+
+/**
+* @brief Listen on a Unix socket, replacing a stale one at the same path.
+*
+* @return The listening socket, or -1 on error.
+*/
+static int __listen(
+    char const * const path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "ZPART: socket path '%s' is too long\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  /* never remove anything but a socket */
+  struct stat st;
+  if(stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+
+  int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+      listen(fd, 8) != 0) {
+    fprintf(stderr, "ZPART: failed to listen on '%s': %s\n", path,
+        strerror(errno));
+    if(fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+
+/**
+* @brief Close the current client connection, if any.
+*/
+static void __hang_up(
+    serve_conn * const conn)
+{
+  if(conn->in != NULL) {
+    fclose(conn->in);
+    fclose(conn->out);
+    conn->in = NULL;
+    conn->out = NULL;
+  }
+}
+
+
+/**
+* @brief Read the next request on rank 0, waiting for a new client whenever
+*        the current one hangs up.
+*
+* @param conn The connection.
+* @param line [IN/OUT] The getline() buffer.
+* @param len [IN/OUT] The size of 'line'.
+*/
+static void __read_request(
+    serve_conn * const conn,
+    char ** const line,
+    size_t * const len)
+{
+  while(1) {
+    if(conn->in == NULL) {
+      int const cfd = accept(conn->lfd, NULL, NULL);
+      if(cfd < 0) {
+        continue;
+      }
+      conn->in = fdopen(cfd, "r");
+      conn->out = fdopen(dup(cfd), "w");
+    }
+    if(getline(line, len, conn->in) != -1) {
+      return;
+    }
+    __hang_up(conn);
+  }
+}
+
+
+/**
+* @brief Send a reply to the current client on rank 0.
+*/
+static void __reply(
+    serve_conn * const conn,
+    char const * const reply)
+{
+  if(conn->out != NULL) {
+    fprintf(conn->out, "%s\n", reply);
+    fflush(conn->out);
+  }
+}
+
+
+/**
+* @brief Split a request into whitespace-separated tokens, in place.
+*
+* @return The number of tokens, or -1 if there are more than
+*         SERVE_MAX_TOKENS.
+*/
+static int __tokenize(
+    char * const line,
+    char ** const tokens)
+{
+  int ntokens = 0;
+  char * save = NULL;
+  char * tok = strtok_r(line, " \t\r\n", &save);
+  while(tok != NULL) {
+    if(ntokens == SERVE_MAX_TOKENS) {
+      return -1;
+    }
+    tokens[ntokens++] = tok;
+    tok = strtok_r(NULL, " \t\r\n", &save);
+  }
+  return ntokens;
+}
+
+
+/**
+* @brief Check that 'fname' could be written, without creating it.
+*
+* @return 0 if it can be written, or -1 with errno set.
+*/
+static int __can_write(
+    char const * const fname)
+{
+  struct stat st;
+  if(stat(fname, &st) == 0) {
+    if(S_ISDIR(st.st_mode)) {
+      errno = EISDIR;
+      return -1;
+    }
+    return access(fname, W_OK);
+  }
+
+  /* a new file needs a writable directory */
+  char * dir = strdup(fname);
+  char * const slash = strrchr(dir, '/');
+  int rc;
+  if(slash == NULL) {
+    rc = access(".", W_OK | X_OK);
+  } else {
+    slash[1] = '\0';
+    rc = access(dir, W_OK | X_OK);
+  }
+  free(dir);
+  return rc;
+}
+
+
+/**
+* @brief Check a request on rank 0 before it is handed to every rank, so that
+*        nothing which would stop the readers or writers gets through.
+*
+* @param reg The registry.
+* @param tokens The request.
+* @param ntokens The number of tokens.
+* @param reply [OUT] Why the request was rejected.
+*
+* @return 1 if the request may be handled.
+*/
+static int __check(
+    serve_registry const * const reg,
+    char ** const tokens,
+    int ntokens,
+    char * const reply)
+{
+  char const * const cmd = tokens[0];
+
+  if(strcmp(cmd, "list") == 0 || strcmp(cmd, "shutdown") == 0) {
+    if(ntokens != 1) {
+      snprintf(reply, SERVE_MAX_REPLY, "error usage: %s", cmd);
+      return 0;
+    }
+    return 1;
+  }
+
+  if(strcmp(cmd, "evict") == 0) {
+    if(ntokens != 2) {
+      snprintf(reply, SERVE_MAX_REPLY, "error usage: evict FILE");
+      return 0;
+    }
+    if(__find(reg, tokens[1]) < 0) {
+      snprintf(reply, SERVE_MAX_REPLY, "error '%s' is not resident",
+          tokens[1]);
+      return 0;
+    }
+    return 1;
+  }
+
+  if(strcmp(cmd, "load") == 0) {
+    if(ntokens != 2) {
+      snprintf(reply, SERVE_MAX_REPLY, "error usage: load FILE");
+      return 0;
+    }
+  } else if(strcmp(cmd, "partition") == 0) {
+    if(ntokens < 4) {
+      snprintf(reply, SERVE_MAX_REPLY,
+          "error usage: partition FILE NPARTS OUT [KEY=VAL ...]");
+      return 0;
+    }
+    char * endptr;
+    long const nparts = strtol(tokens[2], &endptr, 10);
+    if(endptr == tokens[2] || *endptr != '\0' || nparts < 1) {
+      snprintf(reply, SERVE_MAX_REPLY,
+          "error positive integer expected for #partitions");
+      return 0;
+    }
+    for(int t=4; t < ntokens; ++t) {
+      if(strchr(tokens[t], '=') == NULL) {
+        snprintf(reply, SERVE_MAX_REPLY, "error expected KEY=VAL, got '%s'",
+            tokens[t]);
+        return 0;
+      }
+    }
+    if(__can_write(tokens[3]) != 0) {
+      snprintf(reply, SERVE_MAX_REPLY, "error cannot write '%s': %s",
+          tokens[3], strerror(errno));
+      return 0;
+    }
+  } else {
+    snprintf(reply, SERVE_MAX_REPLY, "error unknown request '%s'", cmd);
+    return 0;
+  }
+
+  /* load and partition may need to read the file */
+  if(__find(reg, tokens[1]) < 0 && access(tokens[1], R_OK) != 0) {
+    snprintf(reply, SERVE_MAX_REPLY, "error cannot read '%s': %s",
+        tokens[1], strerror(errno));
+    return 0;
+  }
+  return 1;
+}
+
+
+/**
+* @brief Partition a resident hypergraph, write the parts, and describe the
+*        result in 'reply'.
+*/
+static void __partition(
+    serve_registry * const reg,
+    char ** const tokens,
+    int ntokens,
+    serve_opts const * const opts,
+    MPI_Comm comm,
+    char * const reply)
+{
+  char const * const fname = tokens[1];
+  int const nparts = (int) strtol(tokens[2], NULL, 10);
+  char const * const ofname = tokens[3];
+
+  MPI_Barrier(comm);
+  zp_timer_t req_time;
+  timer_fstart(&req_time);
+
+  int loaded;
+  hgraph * hg = __get(reg, fname, opts, comm, &loaded);
+  if(hg == NULL) {
+    snprintf(reply, SERVE_MAX_REPLY, "error failed to load '%s'", fname);
+    return;
+  }
+
+  /* the server's parameters, then the request's */
+  zparams params = {0, NULL, NULL};
+  if(opts->params != NULL) {
+    for(int i=0; i < opts->params->nparams; ++i) {
+      zparams_set(&params, opts->params->keys[i], opts->params->vals[i]);
+    }
+  }
+  for(int t=4; t < ntokens; ++t) {
+    char * const eq = strchr(tokens[t], '=');
+    *eq = '\0';
+    zparams_set(&params, tokens[t], eq + 1);
+    *eq = '=';
+  }
+
+  int * parts;
+  if(opts->graph_model != EXPAND_NONE) {
+    parts = partition_graph(hg, comm, nparts, &params, opts->graph_model,
+        opts->clique_cap);
+  } else {
+    parts = partition(hg, comm, nparts, &params, opts->phg_stats);
+  }
+  zparams_free(&params);
+  if(parts == NULL) {
+    snprintf(reply, SERVE_MAX_REPLY, "error partitioning '%s' failed", fname);
+    return;
+  }
+
+  if(opts->refine_rounds > 0) {
+    refine_parts(hg, parts, nparts, opts->refine_rounds, opts->refine_seconds,
+        comm);
+  }
+  if(opts->do_map) {
+    int * perm = map_parts(hg, parts, nparts, opts->topo_fname, comm);
+    for(int v=0; v < hg->nlocal_v; ++v) {
+      parts[v] = perm[parts[v]];
+    }
+    free(perm);
+  }
+
+  write_parts(comm, hg, parts, ofname);
+
+  /* evaluate */
+  long long cutnets;
+  long long const cut = hgraph_cut(hg, parts, nparts, comm, &cutnets);
+  long long * sizes = (long long *) calloc(nparts, sizeof(long long));
+  for(int v=0; v < hg->nlocal_v; ++v) {
+    ++sizes[parts[v]];
+  }
+  MPI_Allreduce(MPI_IN_PLACE, sizes, nparts, MPI_LONG_LONG, MPI_SUM, comm);
+  long long maxsize = 0;
+  for(int p=0; p < nparts; ++p) {
+    if(sizes[p] > maxsize) {
+      maxsize = sizes[p];
+    }
+  }
+  free(sizes);
+  free(parts);
+
+  MPI_Barrier(comm);
+  timer_stop(&req_time);
+
+  snprintf(reply, SERVE_MAX_REPLY,
+      "ok cut %lld cutnets %lld imbalance %0.3f time %0.3fs%s", cut, cutnets,
+      (double) maxsize * nparts /
+          (double) (hg->nglobal_v > 0 ? hg->nglobal_v : 1),
+      req_time.seconds, loaded ? " (loaded)" : "");
+}
+
+
+/**
+* @brief Handle a checked request on every rank.
+*
+* @return 0 if the server should shut down.
+*/
+static int __handle(
+    serve_registry * const reg,
+    char ** const tokens,
+    int ntokens,
+    serve_opts const * const opts,
+    MPI_Comm comm,
+    char * const reply)
+{
+  char const * const cmd = tokens[0];
+
+  if(strcmp(cmd, "shutdown") == 0) {
+    snprintf(reply, SERVE_MAX_REPLY, "ok shutting down");
+    return 0;
+  }
+
+  if(strcmp(cmd, "list") == 0) {
+    int off = snprintf(reply, SERVE_MAX_REPLY, "ok %d resident",
+        reg->nentries);
+    for(int i=0; i < reg->nentries && off < SERVE_MAX_REPLY; ++i) {
+      off += snprintf(reply + off, SERVE_MAX_REPLY - off, " %s",
+          reg->entries[i].fname);
+    }
+  } else if(strcmp(cmd, "evict") == 0) {
+    __evict(reg, __find(reg, tokens[1]));
+    snprintf(reply, SERVE_MAX_REPLY, "ok evicted '%s'", tokens[1]);
+  } else if(strcmp(cmd, "load") == 0) {
+    MPI_Barrier(comm);
+    zp_timer_t load_time;
+    timer_fstart(&load_time);
+    int loaded;
+    hgraph * hg = __get(reg, tokens[1], opts, comm, &loaded);
+    MPI_Barrier(comm);
+    timer_stop(&load_time);
+    if(hg == NULL) {
+      snprintf(reply, SERVE_MAX_REPLY, "error failed to load '%s'",
+          tokens[1]);
+    } else {
+      snprintf(reply, SERVE_MAX_REPLY,
+          "ok %lld vertices %lld hyperedges time %0.3fs%s",
+          (long long) hg->nglobal_v, (long long) hg->nglobal_h,
+          load_time.seconds, loaded ? " (loaded)" : " (resident)");
+    }
+  } else if(strcmp(cmd, "partition") == 0) {
+    __partition(reg, tokens, ntokens, opts, comm, reply);
+  }
+
+  return 1;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+int serve(
+    char const * const path,
+    serve_opts const * const opts,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  serve_conn conn;
+  conn.lfd = -1;
+  conn.in = NULL;
+  conn.out = NULL;
+  if(rank == 0) {
+    conn.lfd = __listen(path);
+    /* a client which hangs up early must not take the server with it */
+    signal(SIGPIPE, SIG_IGN);
+  }
+  int ok = (conn.lfd >= 0);
+  MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+  if(!ok) {
+    return 1;
+  }
+  if(rank == 0) {
+    printf("Serving on '%s'\n", path);
+    fflush(stdout);
+  }
+
+  serve_registry reg;
+  reg.max_entries = (opts->max_resident > 0) ? opts->max_resident : 1;
+  reg.entries = (serve_entry *) malloc(reg.max_entries * sizeof(*reg.entries));
+  reg.nentries = 0;
+  reg.clock = 0;
+
+  char * line = NULL;
+  size_t len = 0;
+  char * tokens[SERVE_MAX_TOKENS];
+  char reply[SERVE_MAX_REPLY];
+  int running = 1;
+  while(running) {
+    /* rank 0 reads and checks requests until it has one worth sharing */
+    int nbytes = 0;
+    if(rank == 0) {
+      while(1) {
+        __read_request(&conn, &line, &len);
+        nbytes = (int) strlen(line);
+        if(nbytes >= SERVE_MAX_REQUEST) {
+          __reply(&conn, "error request too long");
+          continue;
+        }
+        char copy[SERVE_MAX_REQUEST];
+        memcpy(copy, line, nbytes + 1);
+        int const ntokens = __tokenize(copy, tokens);
+        if(ntokens == 0) {
+          continue;
+        }
+        if(ntokens < 0) {
+          __reply(&conn, "error too many tokens");
+          continue;
+        }
+        if(__check(&reg, tokens, ntokens, reply)) {
+          break;
+        }
+        __reply(&conn, reply);
+      }
+    }
+
+    MPI_Bcast(&nbytes, 1, MPI_INT, 0, comm);
+    if(rank != 0 && len < (size_t) nbytes + 1) {
+      len = nbytes + 1;
+      line = (char *) realloc(line, len);
+    }
+    MPI_Bcast(line, nbytes + 1, MPI_CHAR, 0, comm);
+
+    int const ntokens = __tokenize(line, tokens);
+    if(rank == 0) {
+      printf("Request: %s", tokens[0]);
+      for(int t=1; t < ntokens; ++t) {
+        printf(" %s", tokens[t]);
+      }
+      printf("\n");
+    }
+    running = __handle(&reg, tokens, ntokens, opts, comm, reply);
+    if(rank == 0) {
+      printf("Reply: %s\n", reply);
+      fflush(stdout);
+      __reply(&conn, reply);
+    }
+  }
+
+  if(rank == 0) {
+    __hang_up(&conn);
+    close(conn.lfd);
+    unlink(path);
+  }
+
+  while(reg.nentries > 0) {
+    __evict(&reg, reg.nentries - 1);
+  }
+  free(reg.entries);
+  free(line);
+
+  return 0;
+}
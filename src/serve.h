@@ -0,0 +1,83 @@
+#ifndef ZPART_SERVE_H
+#define ZPART_SERVE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+#include "part.h"
+#include "sparse.h"
+#include "expand.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+#define serve_opts zpart_serve_opts
+/**
+* @brief How the server loads hypergraphs and partitions them. These are the
+*        commandline options of a normal run and apply to every request.
+*/
+typedef struct
+{
+  char const * format;      /** 'hmetis', 'mtx', 'patoh', or NULL to guess. */
+  hgraph_model model;       /** Hypergraph model of matrices. */
+  validate_mode validate;   /** How to validate input. */
+  char const * layout;      /** 'edge', 'vertex', or 'auto'. */
+  int compress;             /** Store pins compressed. */
+  int reorder_rounds;       /** Rounds of reorder_hgraph(), or 0. */
+  int owner_pins;           /** Move vertices with reorder_owners(). */
+
+  zparams const * params;   /** Zoltan overrides below each request's own. */
+  int phg_stats;            /** Report PHG statistics. */
+  expand_model graph_model; /** Partition a graph expansion instead. */
+  int clique_cap;           /** The largest hyperedge expanded to a clique. */
+  int refine_rounds;        /** Rounds of refine_parts(), or 0. */
+  double refine_seconds;    /** Time limit of refine_parts(), or 0. */
+  int do_map;               /** Relabel parts with map_parts(). */
+  char const * topo_fname;  /** Topology file for map_parts(), or NULL. */
+
+  int max_resident;         /** The most hypergraphs to keep loaded. */
+} serve_opts;
+
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define serve zpart_serve
+/**
+* @brief Serve partitioning requests on a Unix socket until a 'shutdown'
+*        request. Rank 0 accepts one client at a time and reads one request
+*        per line, checks it, and broadcasts it to all ranks. Each reply is a
+*        single line starting with 'ok' or 'error'. Requests are:
+*
+*          load FILE                          make FILE resident
+*          partition FILE NPARTS OUT [K=V..]  partition FILE (loading it if
+*                                             needed) and write parts to OUT
+*          evict FILE                         drop FILE
+*          list                               list resident hypergraphs
+*          shutdown                           stop the server
+*
+*        Loaded hypergraphs are kept until evicted. When 'max_resident' are
+*        loaded, the least recently used is dropped before loading another,
+*        so no more than 'max_resident' are ever in memory. Requests of more
+*        than 256 tokens are rejected.
+*
+* @param path The socket to listen on. An existing socket is replaced.
+* @param opts How to load and partition hypergraphs.
+* @param comm The communicator to partition with.
+*
+* @return 0 after a clean shutdown, or non-zero if the socket could not be
+*         opened.
+*/
+int serve(
+    char const * const path,
+    serve_opts const * const opts,
+    MPI_Comm comm);
+
+#endif
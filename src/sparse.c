@@ -0,0 +1,537 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "sparse.h"
+#include "comm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <assert.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/**
+* @brief Header information parsed by rank 0 and broadcast to everyone.
+*/
+typedef struct
+{
+  long long ok;
+  long long nrows;      /** Rows (mtx) or cells (patoh). */
+  long long ncols;      /** Columns (mtx) or nets (patoh). */
+  long long nnz;        /** Nonzeros (mtx) or pins (patoh). */
+  long long symmetric;  /** mtx only: expand off-diagonal entries. */
+  long long base;       /** patoh only: index base. */
+  long long data_start; /** Byte offset of the first data line. */
+} sparse_header;
+
+#define HEADER_LEN 7
+
+
+/**
+* @brief A growable array of idx_t.
+*/
+typedef struct
+{
+  idx_t * vals;
+  size_t len;
+  size_t cap;
+} idx_vec;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void __vec_push(
+    idx_vec * const vec,
+    idx_t const val)
+{
+  if(vec->len == vec->cap) {
+    vec->cap = (vec->cap == 0) ? 1024 : 2 * vec->cap;
+    vec->vals = (idx_t *) realloc(vec->vals, vec->cap * sizeof(idx_t));
+  }
+  vec->vals[vec->len++] = val;
+}
+
+
+/**
+* @brief Return 1 if a line is blank or a comment.
+*/
+static int __skip_line(
+    char const * line)
+{
+  while(isspace(*line)) {
+    ++line;
+  }
+  return (*line == '\0' || *line == '%');
+}
+
+
+/**
+* @brief Parse the header of a MatrixMarket file.
+*
+* @param fin The file, positioned at the start.
+* @param line A getline() buffer owned by the caller.
+* @param len The length of 'line'.
+* @param header [OUT] The parsed header.
+*
+* @return 1 on success, 0 on error.
+*/
+static int __parse_mtx_header(
+    FILE * fin,
+    char ** line,
+    size_t * len,
+    sparse_header * const header)
+{
+  if(getline(line, len, fin) == -1 ||
+      strncasecmp(*line, "%%MatrixMarket", 14) != 0) {
+    fprintf(stderr, "ZPART: input is not a MatrixMarket file.\n");
+    return 0;
+  }
+
+  char obj[64], fmt[64], field[64], sym[64];
+  if(sscanf(*line + 14, "%63s %63s %63s %63s", obj, fmt, field, sym) != 4 ||
+      strcasecmp(obj, "matrix") != 0 || strcasecmp(fmt, "coordinate") != 0) {
+    fprintf(stderr, "ZPART: only MatrixMarket coordinate matrices are "
+        "supported.\n");
+    return 0;
+  }
+  header->symmetric = (strcasecmp(sym, "general") != 0);
+
+  /* skip comments until the size line */
+  do {
+    if(getline(line, len, fin) == -1) {
+      fprintf(stderr, "ZPART: unexpected end of input.\n");
+      return 0;
+    }
+  } while(__skip_line(*line));
+
+  if(sscanf(*line, "%lld %lld %lld", &header->nrows, &header->ncols,
+        &header->nnz) != 3) {
+    fprintf(stderr, "ZPART: malformed MatrixMarket size line.\n");
+    return 0;
+  }
+  return 1;
+}
+
+
+/**
+* @brief Parse the header of a PaToH file.
+*
+* @param fin The file, positioned at the start.
+* @param line A getline() buffer owned by the caller.
+* @param len The length of 'line'.
+* @param header [OUT] The parsed header.
+*
+* @return 1 on success, 0 on error.
+*/
+static int __parse_patoh_header(
+    FILE * fin,
+    char ** line,
+    size_t * len,
+    sparse_header * const header)
+{
+  do {
+    if(getline(line, len, fin) == -1) {
+      fprintf(stderr, "ZPART: unexpected end of input.\n");
+      return 0;
+    }
+  } while(__skip_line(*line));
+
+  long long scheme = 0;
+  int const nread = sscanf(*line, "%lld %lld %lld %lld %lld", &header->base,
+      &header->nrows, &header->ncols, &header->nnz, &scheme);
+  if(nread < 4) {
+    fprintf(stderr, "ZPART: malformed PaToH header.\n");
+    return 0;
+  }
+  if(scheme != 0) {
+    fprintf(stderr, "ZPART: only unweighted graphs supported right now.\n");
+    return 0;
+  }
+  return 1;
+}
+
+
+/**
+* @brief Parse the header on rank 0 and share it.
+*
+* @param fname The file to read from.
+* @param parser The function which parses the header.
+* @param header [OUT] The parsed header.
+* @param comm The communicator.
+*
+* @return 1 on success, 0 on error.
+*/
+static int __bcast_header(
+    char const * const fname,
+    int (* parser)(FILE *, char **, size_t *, sparse_header * const),
+    sparse_header * const header,
+    MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  memset(header, 0, sizeof(*header));
+  if(rank == 0) {
+    FILE * fin;
+    if((fin = fopen(fname, "r")) == NULL) {
+      fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
+    } else {
+      char * line = NULL;
+      size_t len = 0;
+      if(parser(fin, &line, &len, header)) {
+        header->data_start = (long long) ftello(fin);
+        header->ok = 1;
+      }
+      free(line);
+      fclose(fin);
+    }
+  }
+  MPI_Bcast(header, HEADER_LEN, MPI_LONG_LONG, 0, comm);
+  return (int) header->ok;
+}
+
+
+/**
+* @brief Build my chunk of a hypergraph from arbitrary (hedge, vtx) pins.
+*        Hyperedges and vertices are both block-distributed by ID.
+*
+* @param pins The pins as (hedge, vtx) pairs. Freed!
+* @param nglobal_h The number of hyperedges.
+* @param nglobal_v The number of vertices.
+* @param comm The communicator.
+*
+* @return My chunk of the hypergraph.
+*/
+static hgraph * __build_from_pins(
+    idx_vec * const pins,
+    idx_t const nglobal_h,
+    idx_t const nglobal_v,
+    MPI_Comm comm)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  idx_t hchunk = (nglobal_h + npes - 1) / npes;
+  idx_t vchunk = (nglobal_v + npes - 1) / npes;
+  if(hchunk == 0) {
+    hchunk = 1;
+  }
+  if(vchunk == 0) {
+    vchunk = 1;
+  }
+
+  /* send pins to the owners of their hyperedges */
+  int const npins = (int) (pins->len / 2);
+  int * dest = (int *) malloc((npins+1) * sizeof(int));
+  for(int n=0; n < npins; ++n) {
+    dest[n] = (int) (pins->vals[2*n] / hchunk);
+  }
+  int * sendcounts = (int *) malloc(npes * sizeof(int));
+  int * perm = comm_bucket(dest, npins, sendcounts, comm);
+  free(dest);
+  idx_t * sendbuf = (idx_t *) malloc((2*npins+1) * sizeof(idx_t));
+  for(int n=0; n < npins; ++n) {
+    sendbuf[2*perm[n] + 0] = pins->vals[2*n + 0];
+    sendbuf[2*perm[n] + 1] = pins->vals[2*n + 1];
+  }
+  free(perm);
+  free(pins->vals);
+  pins->vals = NULL;
+  pins->len = pins->cap = 0;
+
+  for(int p=0; p < npes; ++p) {
+    sendcounts[p] *= 2;
+  }
+  int nrecv;
+  idx_t * recv = comm_exchange(sendbuf, sendcounts, ZOLTAN_ID_MPI_TYPE,
+      &nrecv, NULL, comm);
+  free(sendbuf);
+  free(sendcounts);
+  nrecv /= 2;
+
+  /* my block of hyperedges and vertices */
+  idx_t hstart = rank * hchunk;
+  idx_t hend = hstart + hchunk;
+  if(hstart > nglobal_h) {
+    hstart = nglobal_h;
+  }
+  if(hend > nglobal_h) {
+    hend = nglobal_h;
+  }
+  idx_t vstart = rank * vchunk;
+  idx_t vend = vstart + vchunk;
+  if(vstart > nglobal_v) {
+    vstart = nglobal_v;
+  }
+  if(vend > nglobal_v) {
+    vend = nglobal_v;
+  }
+
+  int const nh = (int) (hend - hstart);
+  int const nv = (int) (vend - vstart);
+  hgraph * hg = hgraph_alloc(nv, nh, nrecv);
+  hg->nglobal_v = nglobal_v;
+  hg->nglobal_h = nglobal_h;
+  hg->nlocal_v = nv;
+  hg->nlocal_h = nh;
+
+  for(int v=0; v < nv; ++v) {
+    hg->v_gids[v] = vstart + v;
+  }
+  for(int h=0; h < nh; ++h) {
+    hg->h_gids[h] = hstart + h;
+  }
+
+  /* counting sort pins into CSR */
+  memset(hg->eptr, 0, (nh+1) * sizeof(int));
+  for(int n=0; n < nrecv; ++n) {
+    ++hg->eptr[recv[2*n] - hstart + 1];
+  }
+  for(int h=0; h < nh; ++h) {
+    hg->eptr[h+1] += hg->eptr[h];
+  }
+  for(int n=0; n < nrecv; ++n) {
+    hg->eind[hg->eptr[recv[2*n] - hstart]++] = recv[2*n + 1];
+  }
+  for(int h=nh; h > 0; --h) {
+    hg->eptr[h] = hg->eptr[h-1];
+  }
+  hg->eptr[0] = 0;
+
+  free(recv);
+  return hg;
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+FILE * open_range(
+    char const * const fname,
+    long long data_start,
+    MPI_Comm comm,
+    long long * end)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  FILE * fin;
+  if((fin = fopen(fname, "r")) == NULL) {
+    fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
+    MPI_Abort(comm, 1);
+  }
+
+  fseeko(fin, 0, SEEK_END);
+  long long const size = (long long) ftello(fin);
+  long long const len = size - data_start;
+  long long const start = data_start + ((len * rank) / npes);
+  *end = data_start + ((len * (rank+1)) / npes);
+
+  if(start == data_start) {
+    fseeko(fin, (off_t) start, SEEK_SET);
+    return fin;
+  }
+
+  /* skip the line straddling our start, unless we begin on a fresh line */
+  fseeko(fin, (off_t) (start - 1), SEEK_SET);
+  int c = fgetc(fin);
+  while(c != '\n' && c != EOF) {
+    c = fgetc(fin);
+  }
+  return fin;
+}
+
+
+hgraph * distribute_mtx(
+    char const * const fname,
+    hgraph_model model,
+    validate_mode validate,
+    MPI_Comm comm)
+{
+  sparse_header header;
+  if(!__bcast_header(fname, __parse_mtx_header, &header, comm)) {
+    return NULL;
+  }
+
+  /* parse my (row, col) entries, expanding symmetry */
+  long long end;
+  FILE * fin = open_range(fname, header.data_start, comm, &end);
+  idx_vec ents = {NULL, 0, 0};
+  char * line = NULL;
+  size_t len = 0;
+  while((long long) ftello(fin) < end && getline(&line, &len, fin) != -1) {
+    if(__skip_line(line)) {
+      continue;
+    }
+    char * ptr = line;
+    /* 1-indexed, so 0 wraps and is caught by validation */
+    idx_t const i = (idx_t) (strtoll(ptr, &ptr, 10) - 1);
+    idx_t const j = (idx_t) (strtoll(ptr, &ptr, 10) - 1);
+    __vec_push(&ents, i);
+    __vec_push(&ents, j);
+    if(header.symmetric && i != j) {
+      __vec_push(&ents, j);
+      __vec_push(&ents, i);
+    }
+  }
+  free(line);
+  fclose(fin);
+
+  /* build pins according to the model */
+  idx_t const nrows = (idx_t) header.nrows;
+  idx_t const ncols = (idx_t) header.ncols;
+  long long const nents = (long long) (ents.len / 2);
+  idx_vec pins = {NULL, 0, 0};
+  idx_t nglobal_h = 0;
+  idx_t nglobal_v = 0;
+
+  switch(model) {
+  case MODEL_COLUMN_NET:
+    nglobal_h = ncols;
+    nglobal_v = nrows;
+    for(long long e=0; e < nents; ++e) {
+      __vec_push(&pins, ents.vals[2*e + 1]);
+      __vec_push(&pins, ents.vals[2*e + 0]);
+    }
+    break;
+
+  case MODEL_ROW_NET:
+    nglobal_h = nrows;
+    nglobal_v = ncols;
+    for(long long e=0; e < nents; ++e) {
+      __vec_push(&pins, ents.vals[2*e + 0]);
+      __vec_push(&pins, ents.vals[2*e + 1]);
+    }
+    break;
+
+  case MODEL_FINE_GRAIN: {
+    /* each nonzero is a vertex, numbered globally in file order */
+    long long offset = 0;
+    long long total;
+    MPI_Exscan(&nents, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    MPI_Allreduce(&nents, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if(rank == 0) {
+      offset = 0;
+    }
+
+    nglobal_h = nrows + ncols;
+    nglobal_v = (idx_t) total;
+    for(long long e=0; e < nents; ++e) {
+      idx_t const v = (idx_t) (offset + e);
+      __vec_push(&pins, ents.vals[2*e + 0]);
+      __vec_push(&pins, v);
+      __vec_push(&pins, nrows + ents.vals[2*e + 1]);
+      __vec_push(&pins, v);
+    }
+    break;
+  }
+  }
+  free(ents.vals);
+
+  /* pins whose hyperedge is out of range have no owner to go to, so drop
+   * them here and let validation count them */
+  size_t keep = 0;
+  for(size_t n=0; n < pins.len; n += 2) {
+    if(pins.vals[n] < nglobal_h) {
+      pins.vals[keep++] = pins.vals[n];
+      pins.vals[keep++] = pins.vals[n+1];
+    }
+  }
+  long long const ndropped = (long long) (pins.len - keep) / 2;
+  pins.len = keep;
+
+  hgraph * hg = __build_from_pins(&pins, nglobal_h, nglobal_v, comm);
+  return hgraph_check(hg, fname, validate, ndropped, comm);
+}
+
+
+hgraph * distribute_patoh(
+    char const * const fname,
+    validate_mode validate,
+    MPI_Comm comm)
+{
+  sparse_header header;
+  if(!__bcast_header(fname, __parse_patoh_header, &header, comm)) {
+    return NULL;
+  }
+
+  /* parse my nets; each line is one net */
+  long long end;
+  FILE * fin = open_range(fname, header.data_start, comm, &end);
+  idx_vec lens = {NULL, 0, 0};
+  idx_vec vtxs = {NULL, 0, 0};
+  char * line = NULL;
+  size_t len = 0;
+  while((long long) ftello(fin) < end && getline(&line, &len, fin) != -1) {
+    if(line[0] == '%') {
+      continue;
+    }
+    idx_t count = 0;
+    char * ptr = line;
+    char * next;
+    while(1) {
+      long long const v = strtoll(ptr, &next, 10);
+      if(next == ptr) {
+        break;
+      }
+      __vec_push(&vtxs, (idx_t) (v - header.base));
+      ++count;
+      ptr = next;
+    }
+    __vec_push(&lens, count);
+  }
+  free(line);
+  fclose(fin);
+
+  /* global net IDs follow line order */
+  long long const nlines = (long long) lens.len;
+  long long offset = 0;
+  MPI_Exscan(&nlines, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if(rank == 0) {
+    offset = 0;
+  }
+
+  idx_t const nglobal_h = (idx_t) header.ncols;
+  idx_t const nglobal_v = (idx_t) header.nrows;
+  idx_vec pins = {NULL, 0, 0};
+  size_t n = 0;
+  long long ndropped = 0;
+  for(long long l=0; l < nlines; ++l) {
+    idx_t const h = (idx_t) (offset + l);
+    for(idx_t i=0; i < lens.vals[l]; ++i, ++n) {
+      /* pins of trailing lines past the last net are counted as
+       * out-of-range */
+      if(h < nglobal_h) {
+        __vec_push(&pins, h);
+        __vec_push(&pins, vtxs.vals[n]);
+      } else {
+        ++ndropped;
+      }
+    }
+  }
+  free(lens.vals);
+  free(vtxs.vals);
+
+  hgraph * hg = __build_from_pins(&pins, nglobal_h, nglobal_v, comm);
+  return hgraph_check(hg, fname, validate, ndropped, comm);
+}
@@ -0,0 +1,92 @@
+#ifndef ZPART_SPARSE_H
+#define ZPART_SPARSE_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * STRUCTURES
+ *****************************************************************************/
+
+#define hgraph_model zpart_hgraph_model
+/**
+* @brief Hypergraph models of a sparse matrix.
+*/
+typedef enum
+{
+  MODEL_COLUMN_NET, /** Vertices are rows, hyperedges are columns. */
+  MODEL_ROW_NET,    /** Vertices are columns, hyperedges are rows. */
+  MODEL_FINE_GRAIN  /** Vertices are nonzeros, hyperedges are rows+columns. */
+} hgraph_model;
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+
+#define open_range zpart_open_range
+/**
+* @brief Open 'fname' and position it at the first line of this rank's byte
+*        range of the data section. A line belongs to the rank whose range
+*        contains its first byte.
+*
+* @param fname The file to open.
+* @param data_start The byte offset of the data section.
+* @param comm The communicator.
+* @param end [OUT] The end of this rank's byte range.
+*
+* @return The positioned file.
+*/
+FILE * open_range(
+    char const * const fname,
+    long long data_start,
+    MPI_Comm comm,
+    long long * end);
+
+
+#define distribute_mtx zpart_distribute_mtx
+/**
+* @brief Read a MatrixMarket coordinate matrix in parallel and build its
+*        hypergraph model. Each rank parses a byte range of the file, and pins
+*        are sent to the owners of their hyperedges with an all-to-all.
+*        Symmetric matrices are expanded. Values are ignored.
+*
+* @param fname The file to read from.
+* @param model The hypergraph model to build.
+* @param validate How to handle input problems.
+* @param comm The MPI communicator to distribute among.
+*
+* @return My owned hgraph. NULL on error.
+*/
+hgraph * distribute_mtx(
+    char const * const fname,
+    hgraph_model model,
+    validate_mode validate,
+    MPI_Comm comm);
+
+
+#define distribute_patoh zpart_distribute_patoh
+/**
+* @brief Read an unweighted PaToH hypergraph in parallel. Each rank parses a
+*        byte range of the file, and nets are sent to their owners with an
+*        all-to-all.
+*
+* @param fname The file to read from.
+* @param validate How to handle input problems.
+* @param comm The MPI communicator to distribute among.
+*
+* @return My owned hgraph. NULL on error.
+*/
+hgraph * distribute_patoh(
+    char const * const fname,
+    validate_mode validate,
+    MPI_Comm comm);
+
+#endif
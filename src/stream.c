@@ -0,0 +1,417 @@
+
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+#include "stream.h"
+#include "sparse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/******************************************************************************
+ * TYPES & CONSTANTS
+ *****************************************************************************/
+/* just to make life easier */
+#define idx_t ZOLTAN_ID_TYPE
+
+/* parts may not grow past this factor of the average during streaming */
+static double const STREAM_IMBALANCE = 1.05;
+
+/* exchange assignments after this many pins are read by each rank */
+#define STREAM_SYNC_PINS (1 << 14)
+
+
+/**
+* @brief Per-rank streaming state. 'map' and 'loads' are identical on all ranks
+*        after each synchronization; in between, each rank only sees its own
+*        new assignments.
+*/
+typedef struct
+{
+  int nparts;
+  int npes;
+  double capacity;
+
+  int * map;         /** The part of each global vertex, or -1. */
+  long long * loads; /** The global size of each part as of the last sync. */
+  int * mine;        /** My assignments to each part since the last sync. */
+
+  /* assignments since the last sync, as (vertex, part) pairs */
+  idx_t * pairs;
+  int npairs;
+  int maxpairs;
+
+  /* per-hyperedge part counts and the parts that were touched */
+  int * counts;
+  int * touched;
+} stream_state;
+
+
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+* @brief Estimate the current size of a part. Other ranks are assumed to be
+*        filling it at the same rate as we are.
+*/
+static inline double __est_load(
+    stream_state const * const st,
+    int p)
+{
+  return (double) st->loads[p] + ((double) st->npes * st->mine[p]);
+}
+
+
+/**
+* @brief Return the part with the smallest estimated size.
+*/
+static int __lightest(
+    stream_state const * const st)
+{
+  int best = 0;
+  for(int p=1; p < st->nparts; ++p) {
+    if(__est_load(st, p) < __est_load(st, best)) {
+      best = p;
+    }
+  }
+  return best;
+}
+
+
+/**
+* @brief Assign the unassigned pins of one hyperedge.
+*
+* @param st The streaming state.
+* @param pins The (zero-indexed, in-range) pins of the hyperedge.
+* @param npins The number of pins.
+*/
+static void __assign_hedge(
+    stream_state * const st,
+    idx_t const * const pins,
+    int npins)
+{
+  /* count how many pins each part already holds */
+  int ntouched = 0;
+  int nfree = 0;
+  for(int n=0; n < npins; ++n) {
+    int const p = st->map[pins[n]];
+    if(p < 0) {
+      ++nfree;
+      continue;
+    }
+    if(st->counts[p] == 0) {
+      st->touched[ntouched++] = p;
+    }
+    ++st->counts[p];
+  }
+
+  /* best connectivity, scaled down by how full the part is */
+  int best = -1;
+  double best_score = 0.;
+  for(int t=0; t < ntouched; ++t) {
+    int const p = st->touched[t];
+    double const load = __est_load(st, p);
+    if(load < st->capacity) {
+      double const score = st->counts[p] * (1. - (load / st->capacity));
+      if(best == -1 || score > best_score ||
+          (score == best_score && load < __est_load(st, best))) {
+        best = p;
+        best_score = score;
+      }
+    }
+    st->counts[p] = 0;
+  }
+
+  if(nfree == 0) {
+    return;
+  }
+
+  for(int n=0; n < npins; ++n) {
+    idx_t const v = pins[n];
+    if(st->map[v] >= 0) {
+      continue;
+    }
+    if(best == -1 || __est_load(st, best) >= st->capacity) {
+      best = __lightest(st);
+    }
+    st->map[v] = best;
+    ++st->mine[best];
+
+    if(st->npairs == st->maxpairs) {
+      st->maxpairs = (st->maxpairs == 0) ? 1024 : 2 * st->maxpairs;
+      st->pairs = (idx_t *) realloc(st->pairs,
+          2 * st->maxpairs * sizeof(idx_t));
+    }
+    st->pairs[2*st->npairs + 0] = v;
+    st->pairs[2*st->npairs + 1] = (idx_t) best;
+    ++st->npairs;
+  }
+}
+
+
+/**
+* @brief Exchange the assignments made since the last sync. Everyone first
+*        drops their own, then applies all of them in rank order, so the
+*        lowest rank wins any conflict and 'map' is identical everywhere.
+*
+* @param st The streaming state.
+* @param done Whether I have reached the end of my input.
+* @param comm The communicator.
+*
+* @return 1 if every rank has reached the end of its input.
+*/
+static int __sync(
+    stream_state * const st,
+    int done,
+    MPI_Comm comm)
+{
+  int const npes = st->npes;
+
+  int mine[2];
+  mine[0] = 2 * st->npairs;
+  mine[1] = done;
+  int * info = (int *) malloc(2 * npes * sizeof(int));
+  MPI_Allgather(mine, 2, MPI_INT, info, 2, MPI_INT, comm);
+
+  int * counts = (int *) malloc(npes * sizeof(int));
+  int * displs = (int *) malloc((npes+1) * sizeof(int));
+  int alldone = 1;
+  displs[0] = 0;
+  for(int p=0; p < npes; ++p) {
+    counts[p] = info[2*p];
+    displs[p+1] = displs[p] + counts[p];
+    alldone = alldone && info[2*p + 1];
+  }
+  free(info);
+
+  idx_t * all = (idx_t *) malloc((displs[npes]+1) * sizeof(idx_t));
+  MPI_Allgatherv(st->pairs, 2 * st->npairs, ZOLTAN_ID_MPI_TYPE,
+      all, counts, displs, ZOLTAN_ID_MPI_TYPE, comm);
+
+  for(int i=0; i < st->npairs; ++i) {
+    st->map[st->pairs[2*i]] = -1;
+  }
+  for(int i=0; i < displs[npes] / 2; ++i) {
+    idx_t const v = all[2*i];
+    int const p = (int) all[2*i + 1];
+    if(st->map[v] < 0) {
+      st->map[v] = p;
+      ++st->loads[p];
+    }
+  }
+  free(all);
+  free(counts);
+  free(displs);
+
+  st->npairs = 0;
+  memset(st->mine, 0, st->nparts * sizeof(int));
+
+  return alldone;
+}
+
+
+/**
+* @brief Parse the header of an hMetis file on rank 0 and broadcast it.
+*
+* @param fname The file to read.
+* @param comm The communicator.
+* @param header [OUT] {ok, nhedges, nvtxs, data_start}.
+*/
+static void __read_header(
+    char const * const fname,
+    MPI_Comm comm,
+    long long * const header)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  memset(header, 0, 4 * sizeof(*header));
+  if(rank == 0) {
+    FILE * fin;
+    if((fin = fopen(fname, "r")) == NULL) {
+      fprintf(stderr, "ZPART: failed to open '%s'\n", fname);
+    } else {
+      char * line = NULL;
+      size_t len = 0;
+      ssize_t nbytes;
+      do {
+        nbytes = getline(&line, &len, fin);
+      } while(nbytes != -1 && line[0] == '%');
+
+      long long fmt = 0;
+      int nread = 0;
+      if(nbytes != -1) {
+        nread = sscanf(line, "%lld %lld %lld", &header[1], &header[2], &fmt);
+      }
+      if(nread < 2 || fmt != 0) {
+        fprintf(stderr, "ZPART: only unweighted graphs supported right now.\n");
+      } else {
+        header[0] = 1;
+        header[3] = (long long) ftello(fin);
+      }
+      free(line);
+      fclose(fin);
+    }
+  }
+  MPI_Bcast(header, 4, MPI_LONG_LONG, 0, comm);
+}
+
+
+
+/******************************************************************************
+ * PUBLIC FUNCTIONS
+ *****************************************************************************/
+hgraph * stream_partition(
+    char const * const fname,
+    int nparts,
+    MPI_Comm comm,
+    int ** parts)
+{
+  int rank, npes;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &npes);
+
+  long long header[4];
+  __read_header(fname, comm, header);
+  if(!header[0]) {
+    return NULL;
+  }
+  idx_t const nhedges = (idx_t) header[1];
+  idx_t const nvtxs = (idx_t) header[2];
+
+  stream_state st;
+  st.nparts = nparts;
+  st.npes = npes;
+  st.capacity = STREAM_IMBALANCE * (double) nvtxs / (double) nparts;
+  if(st.capacity < 1.) {
+    st.capacity = 1.;
+  }
+  st.map = (int *) malloc((nvtxs+1) * sizeof(int));
+  for(idx_t v=0; v < nvtxs; ++v) {
+    st.map[v] = -1;
+  }
+  st.loads = (long long *) calloc(nparts, sizeof(long long));
+  st.mine = (int *) calloc(nparts, sizeof(int));
+  st.pairs = NULL;
+  st.npairs = 0;
+  st.maxpairs = 0;
+  st.counts = (int *) calloc(nparts, sizeof(int));
+  st.touched = (int *) malloc(nparts * sizeof(int));
+
+  /* stream my byte range, one hyperedge at a time */
+  long long end;
+  FILE * fin = open_range(fname, header[3], comm, &end);
+  char * line = NULL;
+  size_t len = 0;
+  idx_t * pins = NULL;
+  int maxpins = 0;
+  long long npins = 0;
+  long long nbad = 0;
+  int nsyncs = 0;
+  int done = 0;
+  while(1) {
+    long long const sync_at = npins + STREAM_SYNC_PINS;
+    while(!done && npins < sync_at) {
+      if((long long) ftello(fin) >= end || getline(&line, &len, fin) == -1) {
+        done = 1;
+        break;
+      }
+      if(line[0] == '%') {
+        continue;
+      }
+
+      /* 1-indexed pins; out-of-range ones are skipped */
+      int n = 0;
+      char * ptr = line;
+      char * next;
+      while(1) {
+        long long const pin = strtoll(ptr, &next, 10);
+        if(next == ptr) {
+          break;
+        }
+        ptr = next;
+        if(pin < 1 || pin > (long long) nvtxs) {
+          ++nbad;
+          continue;
+        }
+        if(n == maxpins) {
+          maxpins = (maxpins == 0) ? 64 : 2 * maxpins;
+          pins = (idx_t *) realloc(pins, maxpins * sizeof(idx_t));
+        }
+        pins[n++] = (idx_t) (pin - 1);
+      }
+      npins += n;
+      __assign_hedge(&st, pins, n);
+    }
+
+    ++nsyncs;
+    if(__sync(&st, done, comm)) {
+      break;
+    }
+  }
+  free(line);
+  free(pins);
+  fclose(fin);
+
+  /* vertices without pins fill the emptiest parts */
+  idx_t const target = (nvtxs + nparts - 1) / nparts;
+  int p = 0;
+  for(idx_t v=0; v < nvtxs; ++v) {
+    if(st.map[v] >= 0) {
+      continue;
+    }
+    while(st.loads[p] >= (long long) target) {
+      p = (p + 1) % nparts;
+    }
+    st.map[v] = p;
+    ++st.loads[p];
+  }
+
+  long long totals[2];
+  totals[0] = npins;
+  totals[1] = nbad;
+  MPI_Allreduce(MPI_IN_PLACE, totals, 2, MPI_LONG_LONG, MPI_SUM, comm);
+  if(rank == 0) {
+    long long maxload = 0;
+    for(int q=0; q < nparts; ++q) {
+      if(st.loads[q] > maxload) {
+        maxload = st.loads[q];
+      }
+    }
+    printf("Streaming partition: %lld pins, %d syncs, imbalance %0.3f\n",
+        totals[0], nsyncs,
+        (double) maxload * nparts / (double) (nvtxs > 0 ? nvtxs : 1));
+    if(totals[1] > 0) {
+      printf("Streaming partition: skipped %lld out-of-range pins\n",
+          totals[1]);
+    }
+  }
+
+  /* hand back my block of vertices */
+  idx_t const vstart = (idx_t) (((long long) nvtxs * rank) / npes);
+  idx_t const vend = (idx_t) (((long long) nvtxs * (rank+1)) / npes);
+  hgraph * hg = hgraph_alloc(vend - vstart, 0, 0);
+  hg->nglobal_v = nvtxs;
+  hg->nglobal_h = nhedges;
+  hg->nlocal_con = 0;
+  hg->eptr[0] = 0;
+  *parts = (int *) malloc((vend - vstart + 1) * sizeof(int));
+  for(idx_t v=vstart; v < vend; ++v) {
+    hg->v_gids[v - vstart] = v;
+    (*parts)[v - vstart] = st.map[v];
+  }
+
+  free(st.map);
+  free(st.loads);
+  free(st.mine);
+  free(st.pairs);
+  free(st.counts);
+  free(st.touched);
+
+  return hg;
+}
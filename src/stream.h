@@ -0,0 +1,42 @@
+#ifndef ZPART_STREAM_H
+#define ZPART_STREAM_H
+
+/******************************************************************************
+ * INCLUDES
+ *****************************************************************************/
+
+#include <mpi.h>
+#include "graph.h"
+
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+#define stream_partition zpart_stream_partition
+/**
+* @brief Partition an hMetis hypergraph in one pass while reading it, without
+*        building the hypergraph. Each rank streams a byte range of the file.
+*        The unassigned pins of each hyperedge go to the part which already
+*        holds the most of its pins, scaled down by how full the part is
+*        (linear deterministic greedy), among parts with room left. Ranks
+*        exchange their new assignments and part loads every
+*        STREAM_SYNC_PINS pins, and conflicting assignments go to the lowest
+*        rank. Only a vertex-to-part map and the part loads are kept, never
+*        the pins.
+*
+* @param fname The hMetis file to read from.
+* @param nparts The number of parts.
+* @param comm The communicator to partition with.
+* @param parts [OUT] parts[v] is the part of local vertex 'v'. Must be freed!
+*
+* @return My block of vertices as a hypergraph with no hyperedges, for
+*         write_parts(). NULL on error.
+*/
+hgraph * stream_partition(
+    char const * const fname,
+    int nparts,
+    MPI_Comm comm,
+    int ** parts);
+
+#endif